@@ -0,0 +1,158 @@
+/*
+ * Benchmark of the sweep on polygons with many holes, modelled on parcel
+ * data: a square area covered by a grid of small slanted parcels, each one
+ * being a hole, optionally crossed by long and thin road holes.
+ *
+ * Configure with --enable-sweep-stats to see where the time goes.
+ */
+
+#include <stdio.h>
+#include <glib.h>
+
+#include <p2t/poly2tri.h>
+
+static gint grid = 100;
+static gint repeat = 3;
+static gboolean roads = FALSE;
+static gboolean arena = FALSE;
+
+static GOptionEntry entries[] =
+{
+  { "grid",   'g', 0, G_OPTION_ARG_INT,  &grid,   "Use a grid of N x N parcels",             "N" },
+  { "repeat", 'n', 0, G_OPTION_ARG_INT,  &repeat, "Triangulate N times and keep the fastest", "N" },
+  { "roads",  'r', 0, G_OPTION_ARG_NONE, &roads,  "Add long roads across the whole area",     NULL },
+  { "arena",  'a', 0, G_OPTION_ARG_NONE, &arena,  "Allocate from an arena",                   NULL },
+  { NULL }
+};
+
+static GPtrArray*
+polyline_new (GPtrArray *points, const gdouble *xy, guint n_points)
+{
+  GPtrArray *polyline = g_ptr_array_sized_new (n_points);
+  guint i;
+
+  for (i = 0; i < n_points; i++)
+    {
+      P2tPoint *p = p2t_point_new_dd (xy[2 * i], xy[2 * i + 1]);
+      g_ptr_array_add (polyline, p);
+      g_ptr_array_add (points, p);
+    }
+
+  return polyline;
+}
+
+/* Create the CDT of the area. Its points are added to points, and its
+ * polylines to polylines, so they can be freed with it */
+static P2tCDT*
+create_cdt (GPtrArray *points, GPtrArray *polylines)
+{
+  GRand *rand = g_rand_new_with_seed (1);
+  gdouble size = grid * 10.0;
+  gdouble outline[] = { -5, -5,  size + 5, -5,  size + 5, size + 5,  -5, size + 5 };
+  GPtrArray *polyline = polyline_new (points, outline, 4);
+  P2tCDT *cdt = p2t_cdt_new_full (polyline, arena ? P2T_CDT_USE_ARENA : 0);
+  gint i, j;
+
+  g_ptr_array_add (polylines, polyline);
+
+  if (roads)
+    for (j = 0; j < grid; j += 5)
+      {
+        /* A road between two rows of parcels, rising slightly across the
+         * whole area */
+        gdouble y = j * 10 + 9.2;
+        gdouble road[] = { 0.5, y,  size - 0.5, y + 0.6,  size - 0.5, y + 0.7,  0.5, y + 0.1 };
+
+        polyline = polyline_new (points, road, 4);
+        p2t_cdt_add_hole (cdt, polyline);
+        g_ptr_array_add (polylines, polyline);
+      }
+
+  for (i = 0; i < grid; i++)
+    for (j = 0; j < grid; j++)
+      {
+        /* A parcel with a long and shallow bottom edge */
+        gdouble x = i * 10 + 1 + g_rand_double (rand);
+        gdouble y = j * 10 + 1 + g_rand_double (rand) * (roads ? 0.5 : 1);
+        gdouble slant = 0.3 * g_rand_double (rand);
+        gdouble top = (roads ? 4 : 5) + g_rand_double (rand);
+        gdouble parcel[] = {
+          x, y,
+          x + 3.5 + g_rand_double (rand), y + top,
+          x + 7, y + slant,
+          x + 3.5, y + 1.5 + g_rand_double (rand)
+        };
+
+        polyline = polyline_new (points, parcel, 4);
+        p2t_cdt_add_hole (cdt, polyline);
+        g_ptr_array_add (polylines, polyline);
+      }
+
+  g_rand_free (rand);
+  return cdt;
+}
+
+int
+main (int argc, char *argv[])
+{
+  GOptionContext *context = g_option_context_new ("- benchmark the sweep on polygons with many holes");
+  GError *error = NULL;
+  gint64 best = G_MAXINT64;
+  P2tSweepStats stats;
+  gboolean have_stats = FALSE;
+  guint n_triangles = 0;
+  gint r;
+
+  g_option_context_add_main_entries (context, entries, NULL);
+  if (! g_option_context_parse (context, &argc, &argv, &error))
+    {
+      g_printerr ("%s\n", error->message);
+      return 1;
+    }
+  g_option_context_free (context);
+
+  for (r = 0; r < repeat; r++)
+    {
+      GPtrArray *points = g_ptr_array_new ();
+      GPtrArray *polylines = g_ptr_array_new ();
+      P2tCDT *cdt = create_cdt (points, polylines);
+      gint64 start = g_get_monotonic_time ();
+      guint i;
+
+      p2t_cdt_triangulate (cdt);
+      start = g_get_monotonic_time () - start;
+      if (start < best)
+        {
+          best = start;
+          have_stats = p2t_cdt_get_stats (cdt, &stats);
+        }
+      n_triangles = p2t_cdt_get_triangles (cdt)->len;
+
+      p2t_cdt_free (cdt);
+      for (i = 0; i < polylines->len; i++)
+        g_ptr_array_free ((GPtrArray*) g_ptr_array_index (polylines, i), TRUE);
+      g_ptr_array_free (polylines, TRUE);
+      for (i = 0; i < points->len; i++)
+        p2t_point_free ((P2tPoint*) g_ptr_array_index (points, i));
+      g_ptr_array_free (points, TRUE);
+    }
+
+  printf ("holes: %d, triangles: %u, best time: %.2f ms\n",
+          grid * grid + (roads ? (grid + 4) / 5 : 0), n_triangles, best / 1000.0);
+
+  if (have_stats)
+    {
+      printf ("point events: %" G_GUINT64_FORMAT ", edge events: %" G_GUINT64_FORMAT "\n",
+              stats.point_events, stats.edge_events);
+      printf ("edge walk steps: %" G_GUINT64_FORMAT ", edge rotations: %" G_GUINT64_FORMAT
+              ", edge event flips: %" G_GUINT64_FORMAT "\n",
+              stats.edge_walk_steps, stats.edge_rotations, stats.edge_event_flips);
+      printf ("legalized triangles: %" G_GUINT64_FORMAT ", locate steps: %" G_GUINT64_FORMAT "\n",
+              stats.legalized_triangles, stats.locate_steps);
+      printf ("time (ms): sort %.2f, sweep %.2f, edge events %.2f, finalization %.2f\n",
+              stats.sort_time / 1000.0, stats.sweep_time / 1000.0,
+              stats.edge_event_time / 1000.0, stats.finalization_time / 1000.0);
+    }
+
+  return 0;
+}
@@ -64,8 +64,8 @@ typedef gfloat Point2f[2];
 /**
  * read_points_file:
  * @path: The path to the points & colors file
- * @points: An pointer to an array of pointers to #P2RrPoint will be returned
- *          here. NULL can be passed.
+ * @points: An pointer to an array of doubles, holding the x and y coordinates
+ *          of each point, will be returned here. NULL can be passed.
  * @colors: An pointer to an array of colors will be returned here. NULL can be
  *          passed.
  *
@@ -73,7 +73,7 @@ typedef gfloat Point2f[2];
  */
 void
 read_points_file (const gchar       *path,
-                  P2tPointPtrArray  *points,
+                  GArray           **points,
                   GArray           **colors)
 {
   FILE *f = fopen (path, "r");
@@ -88,7 +88,7 @@ read_points_file (const gchar       *path,
   if (verbose)
     g_print ("Now parsing \"%s\"\n", path);
 
-  if (points != NULL) *points = g_ptr_array_new ();
+  if (points != NULL) *points = g_array_new (FALSE, FALSE, sizeof (gdouble));
   if (colors != NULL) *colors = g_array_new (FALSE, FALSE, sizeof (Color3f));
 
   if (debug_print && points == NULL) g_print ("Points will not be kept\n");
@@ -115,7 +115,8 @@ read_points_file (const gchar       *path,
 
           if (points != NULL)
             {
-              g_ptr_array_add (*points, p2t_point_new (ptc[0], ptc[1]));
+              gdouble xy[2] = { ptc[0], ptc[1] };
+              g_array_append_vals (*points, xy, 2);
               countPts++;
             }
         }
@@ -184,7 +185,7 @@ gint main (int argc, char *argv[])
   GError *error = NULL;
   GOptionContext *context;
 
-  GPtrArray *pts;
+  GArray    *pts;
   GArray    *colors;
 
   P2tCDT *cdt;
@@ -231,7 +232,7 @@ gint main (int argc, char *argv[])
 
   read_points_file (input_file, &pts, &colors);
 
-  cdt = p2t_cdt_new (pts);
+  cdt = p2t_cdt_new_from_xy ((gdouble*) pts->data, 2, pts->len / 2, NULL, 0, P2T_CDT_DEFAULT);
   rcdt = p2tr_cdt_new (cdt);
   p2t_cdt_free (cdt);
   
@@ -273,7 +274,7 @@ gint main (int argc, char *argv[])
 //      p2tr_point_unref ((P2trPoint*) g_ptr_array_index (pts, i));
 //    }
 
-  g_ptr_array_free (pts, TRUE);
+  g_array_free (pts, TRUE);
   g_array_free (colors, TRUE);
   
   return 0;
@@ -0,0 +1,115 @@
+/*
+ * This file is a part of Poly2Tri-C - The C port of the Poly2Tri library
+ * Porting to C done by (c) Barak Itkin <lightningismyname@gmail.com>
+ * http://code.google.com/p/poly2tri-c/
+ *
+ * Poly2Tri Copyright (c) 2009-2010, Poly2Tri Contributors
+ * http://code.google.com/p/poly2tri/
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * * Neither the name of Poly2Tri nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "arena.h"
+
+/* Every block starts with a pointer to the next (older) block. The data of
+ * the block starts right after it, padded so that it is properly aligned */
+#define P2T_ARENA_ALIGN 8
+#define P2T_ARENA_ALIGN_UP(n) (((n) + P2T_ARENA_ALIGN - 1) & ~((gsize) P2T_ARENA_ALIGN - 1))
+#define P2T_ARENA_BLOCK_HEADER P2T_ARENA_ALIGN_UP (sizeof (gpointer))
+
+P2tArena*
+p2t_arena_new (void)
+{
+  P2tArena* THIS = g_slice_new (P2tArena);
+  THIS->blocks = NULL;
+  THIS->pos = THIS->end = NULL;
+  THIS->block_size = 0;
+  return THIS;
+}
+
+gpointer
+p2t_arena_alloc (P2tArena* THIS, gsize size)
+{
+  gpointer result;
+
+  size = P2T_ARENA_ALIGN_UP (size);
+
+  if (THIS->end - THIS->pos < size)
+    {
+      gsize block_size = MAX (P2T_ARENA_INITIAL_BLOCK_SIZE, MIN (THIS->block_size * 2, P2T_ARENA_MAX_BLOCK_SIZE));
+      gchar* block;
+
+      // Objects larger than a whole block get a block of their own
+      block_size = MAX (block_size, P2T_ARENA_BLOCK_HEADER + size);
+
+      block = g_malloc (block_size);
+      *(gpointer*) block = THIS->blocks;
+      THIS->blocks = block;
+      THIS->block_size = block_size;
+      THIS->pos = block + P2T_ARENA_BLOCK_HEADER;
+      THIS->end = block + block_size;
+    }
+
+  result = THIS->pos;
+  THIS->pos += size;
+  return result;
+}
+
+void
+p2t_arena_clear (P2tArena* THIS)
+{
+  gchar *block = THIS->blocks;
+  gpointer next;
+
+  if (block == NULL)
+    return;
+
+  // Keep only the most recent block, which is normally the largest one
+  next = *(gpointer*) block;
+  *(gpointer*) block = NULL;
+  while (next != NULL)
+    {
+      gpointer after = *(gpointer*) next;
+      g_free (next);
+      next = after;
+    }
+
+  THIS->pos = block + P2T_ARENA_BLOCK_HEADER;
+}
+
+void
+p2t_arena_free (P2tArena* THIS)
+{
+  gpointer block = THIS->blocks;
+  while (block != NULL)
+    {
+      gpointer next = *(gpointer*) block;
+      g_free (block);
+      block = next;
+    }
+  g_slice_free (P2tArena, THIS);
+}
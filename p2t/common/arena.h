@@ -0,0 +1,123 @@
+/*
+ * This file is a part of Poly2Tri-C - The C port of the Poly2Tri library
+ * Porting to C done by (c) Barak Itkin <lightningismyname@gmail.com>
+ * http://code.google.com/p/poly2tri-c/
+ *
+ * Poly2Tri Copyright (c) 2009-2010, Poly2Tri Contributors
+ * http://code.google.com/p/poly2tri/
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * * Neither the name of Poly2Tri nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __ARENA_H__
+#define __ARENA_H__
+
+#include <glib.h>
+#include "poly2tri-private.h"
+
+/**
+ * P2T_ARENA_INITIAL_BLOCK_SIZE:
+ *
+ * The size in bytes of the first block of a #P2tArena. Every block after
+ * it is twice as large as the previous one, up to #P2T_ARENA_MAX_BLOCK_SIZE
+ */
+#define P2T_ARENA_INITIAL_BLOCK_SIZE (4 * 1024)
+#define P2T_ARENA_MAX_BLOCK_SIZE (1024 * 1024)
+
+/**
+ * P2tArena:
+ * @blocks: The blocks allocated so far, the most recent one first
+ * @pos: The first free byte in the current block
+ * @end: The end of the current block
+ * @block_size: The size of the most recently allocated block
+ *
+ * A bump allocator which hands out small objects from large contiguous
+ * blocks. Objects can not be freed individually - instead, all of them are
+ * released together when the arena is freed. This saves the cost of a
+ * separate allocation for each object, and keeps objects which were created
+ * together close in memory.
+ */
+struct _P2tArena
+{
+  /*< private >*/
+  gpointer blocks;
+  gchar *pos, *end;
+  gsize block_size;
+};
+
+/**
+ * p2t_arena_new:
+ *
+ * Allocate a new empty #P2tArena. No memory is reserved for objects until
+ * the first call to #p2t_arena_alloc
+ *
+ * Returns: The allocated arena
+ */
+P2tArena* p2t_arena_new (void);
+
+/**
+ * p2t_arena_alloc:
+ * @THIS: The #P2tArena to allocate from
+ * @size: The size in bytes of the requested memory
+ *
+ * Allocate a chunk of memory which stays valid until the arena is freed. The
+ * memory is aligned for storing pointers and doubles, and is not cleared.
+ *
+ * Returns: The allocated memory
+ */
+gpointer p2t_arena_alloc (P2tArena* THIS, gsize size);
+
+/**
+ * p2t_arena_new_struct:
+ * @arena: The #P2tArena to allocate from
+ * @struct_type: The type of the struct to allocate
+ *
+ * A convenience macro for allocating a struct from an arena, in the same
+ * spirit as #g_slice_new
+ */
+#define p2t_arena_new_struct(arena,struct_type) ((struct_type*) p2t_arena_alloc ((arena), sizeof (struct_type)))
+
+/**
+ * p2t_arena_clear:
+ * @THIS: The #P2tArena to clear
+ *
+ * Release all the memory that was allocated from the arena at once, so that
+ * it can be used again. The most recent block is kept for the next allocations,
+ * so an arena which is cleared and refilled with similar amounts of objects
+ * stops allocating memory after the first round
+ */
+void p2t_arena_clear (P2tArena* THIS);
+
+/**
+ * p2t_arena_free:
+ * @THIS: The #P2tArena to free
+ *
+ * Free the arena along with all the memory that was allocated from it
+ */
+void p2t_arena_free (P2tArena* THIS);
+
+#endif
@@ -30,6 +30,15 @@ extern "C"
 #define triangle_val(list) ((P2tTriangle*)((list)->data))
 
 #define g_ptr_array_index_cyclic(array,index_) g_ptr_array_index(array,(index_)%((array)->len))
+
+/* Make room for n_ more elements without changing the length of the array.
+ * GLib has no call for this, but growing the array and shrinking it back
+ * reallocates at most once, and shrinking keeps the allocated memory */
+#define g_ptr_array_reserve(array,n_) G_STMT_START {                 \
+    guint len_ = (array)->len;                                       \
+    g_ptr_array_set_size ((array), len_ + (n_));                     \
+    g_ptr_array_set_size ((array), len_);                            \
+  } G_STMT_END
   
 #ifdef	__cplusplus
 }
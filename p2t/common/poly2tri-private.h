@@ -19,11 +19,13 @@ typedef struct CDT_ P2tCDT;
 typedef struct _P2tEdge P2tEdge;
 typedef struct _P2tPoint P2tPoint;
 typedef struct _P2tTriangle P2tTriangle;
+typedef struct _P2tArena P2tArena;
 typedef struct SweepContext_ P2tSweepContext;
 typedef struct Sweep_ P2tSweep;
 
 typedef struct P2tSweepContextBasin_ P2tSweepContextBasin;
 typedef struct P2tSweepContextEdgeEvent_ P2tSweepContextEdgeEvent;
+typedef struct P2tTriangleMapIter_ P2tTriangleMapIter;
 
 
 #ifdef	__cplusplus
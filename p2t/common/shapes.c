@@ -35,6 +35,7 @@
 #include "shapes.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 /// Default constructor does nothing (for performance).
 
@@ -43,7 +44,6 @@ p2t_point_init (P2tPoint* THIS)
 {
   THIS->x = 0;
   THIS->y = 0;
-  THIS->edge_list = g_ptr_array_new ();
 }
 
 P2tPoint*
@@ -61,7 +61,6 @@ p2t_point_init_dd (P2tPoint* THIS, double x, double y)
 {
   THIS->x = x;
   THIS->y = y;
-  THIS->edge_list = g_ptr_array_new ();
 }
 
 P2tPoint*
@@ -75,7 +74,6 @@ p2t_point_new_dd (double x, double y)
 void
 p2t_point_destroy (P2tPoint* THIS)
 {
-  g_ptr_array_free (THIS->edge_list, TRUE);
 }
 
 void
@@ -110,8 +108,6 @@ p2t_edge_init (P2tEdge* THIS, P2tPoint* p1, P2tPoint* p2)
           assert (FALSE);
         }
     }
-
-  g_ptr_array_add (THIS->q->edge_list, THIS);
 }
 
 P2tEdge*
@@ -149,10 +145,8 @@ p2t_triangle_init (P2tTriangle* THIS, P2tPoint* a, P2tPoint* b, P2tPoint* c)
   THIS->neighbors_[0] = NULL;
   THIS->neighbors_[1] = NULL;
   THIS->neighbors_[2] = NULL;
-  THIS->constrained_edge[0] = THIS->constrained_edge[1] = THIS->constrained_edge[2] = FALSE;
-  THIS->delaunay_edge[0] = THIS->delaunay_edge[1] = THIS->delaunay_edge[2] = FALSE;
-  THIS->interior_ = FALSE;
-
+  THIS->map_index_ = 0;
+  THIS->flags_ = 0;
 }
 // Update neighbor pointers
 
@@ -239,7 +233,7 @@ p2t_triangle_clear_neighbors (P2tTriangle* THIS)
 void
 p2t_triangle_clear_delunay_edges (P2tTriangle* THIS)
 {
-  THIS->delaunay_edge[0] = THIS->delaunay_edge[1] = THIS->delaunay_edge[2] = FALSE;
+  THIS->flags_ &= ~(P2T_TRIANGLE_DELAUNAY_EDGE (0) | P2T_TRIANGLE_DELAUNAY_EDGE (1) | P2T_TRIANGLE_DELAUNAY_EDGE (2));
 }
 
 P2tPoint*
@@ -353,7 +347,7 @@ p2t_triangle_edge_index (P2tTriangle* THIS, const P2tPoint* p1, const P2tPoint*
 void
 p2t_triangle_mark_constrained_edge_i (P2tTriangle* THIS, const int index)
 {
-  THIS->constrained_edge[index] = TRUE;
+  p2t_triangle_set_constrained_edge_i (THIS, index, TRUE);
 }
 
 void
@@ -369,15 +363,15 @@ p2t_triangle_mark_constrained_edge_pt_pt (P2tTriangle* THIS, P2tPoint* p, P2tPoi
 {
   if ((q == THIS->points_[0] && p == THIS->points_[1]) || (q == THIS->points_[1] && p == THIS->points_[0]))
     {
-      THIS->constrained_edge[2] = TRUE;
+      p2t_triangle_set_constrained_edge_i (THIS, 2, TRUE);
     }
   else if ((q == THIS->points_[0] && p == THIS->points_[2]) || (q == THIS->points_[2] && p == THIS->points_[0]))
     {
-      THIS->constrained_edge[1] = TRUE;
+      p2t_triangle_set_constrained_edge_i (THIS, 1, TRUE);
     }
   else if ((q == THIS->points_[1] && p == THIS->points_[2]) || (q == THIS->points_[2] && p == THIS->points_[1]))
     {
-      THIS->constrained_edge[0] = TRUE;
+      p2t_triangle_set_constrained_edge_i (THIS, 0, TRUE);
     }
 }
 
@@ -458,13 +452,13 @@ p2t_triangle_get_constrained_edge_ccw (P2tTriangle* THIS, P2tPoint* p)
 {
   if (p == THIS->points_[0])
     {
-      return THIS->constrained_edge[2];
+      return p2t_triangle_get_constrained_edge_i (THIS, 2);
     }
   else if (p == THIS->points_[1])
     {
-      return THIS->constrained_edge[0];
+      return p2t_triangle_get_constrained_edge_i (THIS, 0);
     }
-  return THIS->constrained_edge[1];
+  return p2t_triangle_get_constrained_edge_i (THIS, 1);
 }
 
 gboolean
@@ -472,13 +466,13 @@ p2t_triangle_get_constrained_edge_cw (P2tTriangle* THIS, P2tPoint* p)
 {
   if (p == THIS->points_[0])
     {
-      return THIS->constrained_edge[1];
+      return p2t_triangle_get_constrained_edge_i (THIS, 1);
     }
   else if (p == THIS->points_[1])
     {
-      return THIS->constrained_edge[2];
+      return p2t_triangle_get_constrained_edge_i (THIS, 2);
     }
-  return THIS->constrained_edge[0];
+  return p2t_triangle_get_constrained_edge_i (THIS, 0);
 }
 
 void
@@ -486,15 +480,15 @@ p2t_triangle_set_constrained_edge_ccw (P2tTriangle* THIS, P2tPoint* p, gboolean
 {
   if (p == THIS->points_[0])
     {
-      THIS->constrained_edge[2] = ce;
+      p2t_triangle_set_constrained_edge_i (THIS, 2, ce);
     }
   else if (p == THIS->points_[1])
     {
-      THIS->constrained_edge[0] = ce;
+      p2t_triangle_set_constrained_edge_i (THIS, 0, ce);
     }
   else
     {
-      THIS->constrained_edge[1] = ce;
+      p2t_triangle_set_constrained_edge_i (THIS, 1, ce);
     }
 }
 
@@ -503,15 +497,15 @@ p2t_triangle_set_constrained_edge_cw (P2tTriangle* THIS, P2tPoint* p, gboolean c
 {
   if (p == THIS->points_[0])
     {
-      THIS->constrained_edge[1] = ce;
+      p2t_triangle_set_constrained_edge_i (THIS, 1, ce);
     }
   else if (p == THIS->points_[1])
     {
-      THIS->constrained_edge[2] = ce;
+      p2t_triangle_set_constrained_edge_i (THIS, 2, ce);
     }
   else
     {
-      THIS->constrained_edge[0] = ce;
+      p2t_triangle_set_constrained_edge_i (THIS, 0, ce);
     }
 }
 
@@ -520,13 +514,13 @@ p2t_triangle_get_delunay_edge_ccw (P2tTriangle* THIS, P2tPoint* p)
 {
   if (p == THIS->points_[0])
     {
-      return THIS->delaunay_edge[2];
+      return p2t_triangle_get_delunay_edge_i (THIS, 2);
     }
   else if (p == THIS->points_[1])
     {
-      return THIS->delaunay_edge[0];
+      return p2t_triangle_get_delunay_edge_i (THIS, 0);
     }
-  return THIS->delaunay_edge[1];
+  return p2t_triangle_get_delunay_edge_i (THIS, 1);
 }
 
 gboolean
@@ -534,13 +528,13 @@ p2t_triangle_get_delunay_edge_cw (P2tTriangle* THIS, P2tPoint* p)
 {
   if (p == THIS->points_[0])
     {
-      return THIS->delaunay_edge[1];
+      return p2t_triangle_get_delunay_edge_i (THIS, 1);
     }
   else if (p == THIS->points_[1])
     {
-      return THIS->delaunay_edge[2];
+      return p2t_triangle_get_delunay_edge_i (THIS, 2);
     }
-  return THIS->delaunay_edge[0];
+  return p2t_triangle_get_delunay_edge_i (THIS, 0);
 }
 
 void
@@ -548,15 +542,15 @@ p2t_triangle_set_delunay_edge_ccw (P2tTriangle* THIS, P2tPoint* p, gboolean e)
 {
   if (p == THIS->points_[0])
     {
-      THIS->delaunay_edge[2] = e;
+      p2t_triangle_set_delunay_edge_i (THIS, 2, e);
     }
   else if (p == THIS->points_[1])
     {
-      THIS->delaunay_edge[0] = e;
+      p2t_triangle_set_delunay_edge_i (THIS, 0, e);
     }
   else
     {
-      THIS->delaunay_edge[1] = e;
+      p2t_triangle_set_delunay_edge_i (THIS, 1, e);
     }
 }
 
@@ -565,15 +559,15 @@ p2t_triangle_set_delunay_edge_cw (P2tTriangle* THIS, P2tPoint* p, gboolean e)
 {
   if (p == THIS->points_[0])
     {
-      THIS->delaunay_edge[1] = e;
+      p2t_triangle_set_delunay_edge_i (THIS, 1, e);
     }
   else if (p == THIS->points_[1])
     {
-      THIS->delaunay_edge[2] = e;
+      p2t_triangle_set_delunay_edge_i (THIS, 2, e);
     }
   else
     {
-      THIS->delaunay_edge[0] = e;
+      p2t_triangle_set_delunay_edge_i (THIS, 0, e);
     }
 }
 
@@ -625,6 +619,169 @@ p2t_point_cmp (gconstpointer a, gconstpointer b)
   return 1;
 }
 
+/* Arrays smaller than this are not worth the setup of the radix sort */
+#define P2T_POINTS_RADIX_MIN 256
+/* Runs of points with the same y which are shorter than this are sorted by x
+ * using insertion sort */
+#define P2T_POINTS_INSERTION_MAX 16
+
+/* A point being sorted, by its index in the input */
+typedef struct
+{
+  guint64 key;
+  guint32 index;
+} P2tPointSortItem;
+
+/* Map a double into an unsigned integer with the same ordering. Negative
+ * zero is mapped like positive zero, since they compare equal */
+static inline guint64
+p2t_point_sort_key (double value)
+{
+  union { double d; guint64 u; } bits;
+  bits.d = value + 0.0;
+  if (bits.u >> 63)
+    return ~bits.u;
+  else
+    return bits.u | G_GUINT64_CONSTANT (0x8000000000000000);
+}
+
+static gint
+p2t_point_sort_item_cmp (gconstpointer a, gconstpointer b, gpointer user_data)
+{
+  guint64 ka = ((const P2tPointSortItem*) a)->key;
+  guint64 kb = ((const P2tPointSortItem*) b)->key;
+  return (ka > kb) - (ka < kb);
+}
+
+/* Sort a run of items with an equal y key by their x coordinate */
+static void
+p2t_points_sort_run (P2tPointPtrArray points, P2tPointSortItem* items, int len)
+{
+  int i, j;
+
+  for (i = 0; i < len; i++)
+    items[i].key = p2t_point_sort_key (point_index (points, items[i].index)->x);
+
+  if (len > P2T_POINTS_INSERTION_MAX)
+    {
+      g_qsort_with_data (items, len, sizeof (P2tPointSortItem), p2t_point_sort_item_cmp, NULL);
+      return;
+    }
+
+  for (i = 1; i < len; i++)
+    {
+      P2tPointSortItem item = items[i];
+      for (j = i; j > 0 && items[j - 1].key > item.key; j--)
+        items[j] = items[j - 1];
+      items[j] = item;
+    }
+}
+
+static gint
+p2t_point_index_cmp (gconstpointer a, gconstpointer b, gpointer points)
+{
+  P2tPoint *ap = point_index ((P2tPointPtrArray) points, *(const guint32*) a);
+  P2tPoint *bp = point_index ((P2tPointPtrArray) points, *(const guint32*) b);
+  return p2t_point_cmp (&ap, &bp);
+}
+
+void
+p2t_points_sort_order (P2tPointPtrArray points, guint32 *order)
+{
+  const int n = points->len;
+  guint counts[8][256] = { { 0 } };
+  P2tPointSortItem *items, *temp, *swap;
+  int i, d, start;
+
+  if (n < P2T_POINTS_RADIX_MIN)
+    {
+      for (i = 0; i < n; i++)
+        order[i] = i;
+      g_qsort_with_data (order, n, sizeof (guint32), p2t_point_index_cmp, points);
+      return;
+    }
+
+  items = g_new (P2tPointSortItem, n);
+  temp = g_new (P2tPointSortItem, n);
+
+  // Pack the y keys with the indices of the points, and count all the
+  // digits in one go
+  for (i = 0; i < n; i++)
+    {
+      items[i].index = i;
+      items[i].key = p2t_point_sort_key (point_index (points, i)->y);
+      for (d = 0; d < 8; d++)
+        counts[d][(items[i].key >> (8 * d)) & 0xff]++;
+    }
+
+  // Stable LSD radix sort by y, one byte at a time
+  for (d = 0; d < 8; d++)
+    {
+      guint offset = 0, c;
+
+      // Skip bytes which are the same in all the keys
+      if (counts[d][(items[0].key >> (8 * d)) & 0xff] == n)
+        continue;
+
+      for (c = 0; c < 256; c++)
+        {
+          guint count = counts[d][c];
+          counts[d][c] = offset;
+          offset += count;
+        }
+
+      for (i = 0; i < n; i++)
+        temp[counts[d][(items[i].key >> (8 * d)) & 0xff]++] = items[i];
+
+      swap = items;
+      items = temp;
+      temp = swap;
+    }
+
+  // Points with the same y are ordered by x
+  for (start = 0, i = 1; i <= n; i++)
+    {
+      if (i == n || items[i].key != items[start].key)
+        {
+          if (i - start > 1)
+            p2t_points_sort_run (points, items + start, i - start);
+          start = i;
+        }
+    }
+
+  for (i = 0; i < n; i++)
+    order[i] = items[i].index;
+
+  g_free (items);
+  g_free (temp);
+}
+
+void
+p2t_points_sort (P2tPointPtrArray points)
+{
+  const int n = points->len;
+  guint32 *order;
+  gpointer *sorted;
+  int i;
+
+  if (n < P2T_POINTS_RADIX_MIN)
+    {
+      g_ptr_array_sort (points, p2t_point_cmp);
+      return;
+    }
+
+  order = g_new (guint32, n);
+  sorted = g_new (gpointer, n);
+
+  p2t_points_sort_order (points, order);
+  for (i = 0; i < n; i++)
+    sorted[i] = points->pdata[order[i]];
+  memcpy (points->pdata, sorted, n * sizeof (gpointer));
+
+  g_free (order);
+  g_free (sorted);
+}
+
 //  /// Add two points_ component-wise.
 //
 //  Point operator + (const Point& a, const Point& b)
@@ -726,11 +883,11 @@ p2t_triangle_contains_pt_pt (P2tTriangle* THIS, P2tPoint* p, P2tPoint* q)
 gboolean
 p2t_triangle_is_interior (P2tTriangle* THIS)
 {
-  return THIS->interior_;
+  return p2t_triangle_get_flag_ (THIS, P2T_TRIANGLE_INTERIOR);
 }
 
 void
 p2t_triangle_is_interior_b (P2tTriangle* THIS, gboolean b)
 {
-  THIS->interior_ = b;
+  p2t_triangle_set_flag_ (THIS, P2T_TRIANGLE_INTERIOR, b);
 }
@@ -46,15 +46,14 @@
  * P2tPoint:
  * @x: The x coordinate of the point
  * @y: The y coordinate of the point
- * @edge_list: The edges this point constitutes an upper ending point
  *
- * A struct to represent 2D points with double precision, and to keep track
- * of the edges this point constitutes an upper ending point
+ * A struct to represent 2D points with double precision. The edges of which
+ * a point is the upper ending point are tracked by the sweep context, so that
+ * a point is nothing more than its coordinates
  */
 struct _P2tPoint
 {
   /*< public >*/
-  P2tEdgePtrArray edge_list;
   double x, y;
 };
 
@@ -182,27 +181,46 @@ void p2t_edge_free (P2tEdge* THIS);
 
 /**
  * P2tTriangle:
- * @constrained_edge: Flags to determine if an edge is a Constrained edge
- * @delaunay_edg: Flags to determine if an edge is a Delauney edge
  * @points_: Triangle points
  * @neighbors_: Neighbor list
- * @interior_: Has this triangle been marked as an interior triangle?
+ * @map_index_: The slot of this triangle in the triangle map of the
+ *              sweep context which created it
+ * @flags_: Which edges are constrained edges, which edges are Delauney edges
+ *          and whether this triangle has been marked as an interior triangle,
+ *          see #P2T_TRIANGLE_CONSTRAINED_EDGE and the other flags
  *
  * A data structure for representing a triangle, while keeping information about
  * neighbor triangles, etc.
  */
 struct _P2tTriangle
 {
-  /*< public >*/
-  gboolean constrained_edge[3];
-  gboolean delaunay_edge[3];
-
   /*< private >*/
   P2tPoint * points_[3];
   struct _P2tTriangle * neighbors_[3];
-  gboolean interior_;
+  guint map_index_;
+  guint8 flags_;
 };
 
+/* The flags of a triangle, packed together in its flags_ */
+#define P2T_TRIANGLE_CONSTRAINED_EDGE(index) (1 << (index))
+#define P2T_TRIANGLE_DELAUNAY_EDGE(index)    (1 << ((index) + 3))
+#define P2T_TRIANGLE_INTERIOR                (1 << 6)
+
+#define p2t_triangle_get_flag_(THIS,flag) (((THIS)->flags_ & (flag)) != 0)
+#define p2t_triangle_set_flag_(THIS,flag,value) \
+  ((THIS)->flags_ = (value) ? ((THIS)->flags_ | (flag)) : ((THIS)->flags_ & ~(flag)))
+
+/* Is the edge at the given index (the edge opposite to the point at that
+ * index) a constrained/Delauney edge? */
+#define p2t_triangle_get_constrained_edge_i(THIS,index) \
+  p2t_triangle_get_flag_ (THIS, P2T_TRIANGLE_CONSTRAINED_EDGE (index))
+#define p2t_triangle_set_constrained_edge_i(THIS,index,ce) \
+  p2t_triangle_set_flag_ (THIS, P2T_TRIANGLE_CONSTRAINED_EDGE (index), ce)
+#define p2t_triangle_get_delunay_edge_i(THIS,index) \
+  p2t_triangle_get_flag_ (THIS, P2T_TRIANGLE_DELAUNAY_EDGE (index))
+#define p2t_triangle_set_delunay_edge_i(THIS,index,e) \
+  p2t_triangle_set_flag_ (THIS, P2T_TRIANGLE_DELAUNAY_EDGE (index), e)
+
 P2tTriangle* p2t_triangle_new (P2tPoint* a, P2tPoint* b, P2tPoint* c);
 void p2t_triangle_init (P2tTriangle* THIS, P2tPoint* a, P2tPoint* b, P2tPoint* c);
 P2tPoint* p2t_triangle_get_point (P2tTriangle* THIS, const int index);
@@ -254,6 +272,28 @@ void p2t_triangle_debug_print (P2tTriangle* THIS);
 
 gint p2t_point_cmp (gconstpointer a, gconstpointer b);
 
+/**
+ * p2t_points_sort:
+ * @points: An array of points
+ *
+ * Sort an array of points into exactly the same order as sorting it with
+ * #p2t_point_cmp - by y and then by x. Large arrays are sorted with a radix
+ * sort on the bit patterns of the coordinates, which is much faster than a
+ * comparison sort on big inputs.
+ */
+void p2t_points_sort (P2tPointPtrArray points);
+
+/**
+ * p2t_points_sort_order:
+ * @points: An array of points
+ * @order: Filled with @points->len indices into @points
+ *
+ * Find the order into which #p2t_points_sort would sort the points, without
+ * moving them: the i'th point of the sorted order is the point at index
+ * order[i] of @points.
+ */
+void p2t_points_sort_order (P2tPointPtrArray points, guint32 *order);
+
 /*  gboolean operator == (const Point& a, const Point& b); */
 gboolean p2t_point_equals (const P2tPoint* a, const P2tPoint* b);
 
@@ -33,6 +33,489 @@
 #include <math.h>
 #include "utils.h"
 
+/* Robust geometric predicates, following "Adaptive Precision Floating-Point
+ * Arithmetic and Fast Robust Geometric Predicates" by Jonathan R. Shewchuk.
+ *
+ * Each predicate is first evaluated in plain floating point arithmetic. Only
+ * if the result is too close to zero for its sign to be trusted, it is
+ * evaluated again exactly, using expansions - sums of non-overlapping doubles
+ * which together represent a number without any rounding error. In between,
+ * the adaptive stages B and C of the paper refine the floating point result
+ * using the rounding errors of the differences and products, which settles
+ * most of the close calls without the full exact evaluation.
+ *
+ * Note that this relies on strict IEEE double arithmetic, where every
+ * operation is rounded on its own. This file must not be compiled with
+ * -ffast-math or with x87 extended precision, and the compiler must not
+ * contract a multiplication and an addition into one fused multiply-add -
+ * which GNU C does by default (-ffp-contract=fast) when the target has FMA
+ * instructions. configure adds -ffp-contract=off for that reason */
+
+/* 2^-53, the relative rounding error of a double operation */
+#define P2T_EPSILON_DBL 1.1102230246251565e-16
+/* 2^27 + 1, used for splitting a double into two halves */
+#define P2T_SPLITTER 134217729.0
+/* Error bounds of the floating point evaluation of the predicates (stage A),
+ * of the adaptive stages B and C, and of rounding the result of stage C */
+#define P2T_ORIENT_ERRBOUND ((3.0 + 16.0 * P2T_EPSILON_DBL) * P2T_EPSILON_DBL)
+#define P2T_ORIENT_ERRBOUND_B ((2.0 + 12.0 * P2T_EPSILON_DBL) * P2T_EPSILON_DBL)
+#define P2T_ORIENT_ERRBOUND_C ((9.0 + 64.0 * P2T_EPSILON_DBL) * P2T_EPSILON_DBL * P2T_EPSILON_DBL)
+#define P2T_INCIRCLE_ERRBOUND ((10.0 + 96.0 * P2T_EPSILON_DBL) * P2T_EPSILON_DBL)
+#define P2T_INCIRCLE_ERRBOUND_B ((4.0 + 48.0 * P2T_EPSILON_DBL) * P2T_EPSILON_DBL)
+#define P2T_INCIRCLE_ERRBOUND_C ((44.0 + 576.0 * P2T_EPSILON_DBL) * P2T_EPSILON_DBL * P2T_EPSILON_DBL)
+#define P2T_RESULT_ERRBOUND ((3.0 + 8.0 * P2T_EPSILON_DBL) * P2T_EPSILON_DBL)
+
+/* x + y = a + b exactly, given |a| >= |b| */
+static inline void
+p2t_fast_two_sum (double a, double b, double *x, double *y)
+{
+  double bvirt;
+  *x = a + b;
+  bvirt = *x - a;
+  *y = b - bvirt;
+}
+
+/* x + y = a + b exactly */
+static inline void
+p2t_two_sum (double a, double b, double *x, double *y)
+{
+  double avirt, bvirt;
+  *x = a + b;
+  bvirt = *x - a;
+  avirt = *x - bvirt;
+  *y = (a - avirt) + (b - bvirt);
+}
+
+/* x + y = a - b exactly */
+static inline void
+p2t_two_diff (double a, double b, double *x, double *y)
+{
+  double avirt, bvirt;
+  *x = a - b;
+  bvirt = a - *x;
+  avirt = *x + bvirt;
+  *y = (a - avirt) + (bvirt - b);
+}
+
+/* The rounding error y of x = a - b, where x was already computed */
+static inline void
+p2t_two_diff_tail (double a, double b, double x, double *y)
+{
+  double bvirt = a - x;
+  double avirt = x + bvirt;
+  *y = (a - avirt) + (bvirt - b);
+}
+
+static inline void
+p2t_split (double a, double *hi, double *lo)
+{
+  double c = P2T_SPLITTER * a;
+  double abig = c - a;
+  *hi = c - abig;
+  *lo = a - *hi;
+}
+
+/* x + y = a * b exactly, where b was already split */
+static inline void
+p2t_two_product_presplit (double a, double b, double bhi, double blo, double *x, double *y)
+{
+  double ahi, alo, err1, err2, err3;
+  *x = a * b;
+  p2t_split (a, &ahi, &alo);
+  err1 = *x - (ahi * bhi);
+  err2 = err1 - (alo * bhi);
+  err3 = err2 - (ahi * blo);
+  *y = (alo * blo) - err3;
+}
+
+/* x + y = a * b exactly */
+static inline void
+p2t_two_product (double a, double b, double *x, double *y)
+{
+  double bhi, blo;
+  p2t_split (b, &bhi, &blo);
+  p2t_two_product_presplit (a, b, bhi, blo, x, y);
+}
+
+/* x[3] + x[2] + x[1] + x[0] = (a1 + a0) - (b1 + b0) exactly */
+static inline void
+p2t_two_two_diff (double a1, double a0, double b1, double b0, double *x)
+{
+  double i, j, k;
+  p2t_two_diff (a0, b0, &i, &x[0]);
+  p2t_two_sum (a1, i, &j, &k);
+  p2t_two_diff (k, b1, &i, &x[1]);
+  p2t_two_sum (j, i, &x[3], &x[2]);
+}
+
+/* x[3] + x[2] + x[1] + x[0] = a * b - c * d exactly */
+static inline void
+p2t_product_expansion (double a, double b, double c, double d, double *x)
+{
+  double ab1, ab0, cd1, cd0;
+  p2t_two_product (a, b, &ab1, &ab0);
+  p2t_two_product (c, d, &cd1, &cd0);
+  p2t_two_two_diff (ab1, ab0, cd1, cd0, x);
+}
+
+/* h = e + f, where e and f are expansions. Returns the length of h */
+static int
+p2t_expansion_sum (int elen, const double *e, int flen, const double *f, double *h)
+{
+  double q, qnew, hh, enow, fnow;
+  int eindex = 0, findex = 0, hindex = 0;
+
+  enow = e[0];
+  fnow = f[0];
+  if ((fnow > enow) == (fnow > -enow))
+    {
+      q = enow;
+      enow = (++eindex < elen) ? e[eindex] : 0;
+    }
+  else
+    {
+      q = fnow;
+      fnow = (++findex < flen) ? f[findex] : 0;
+    }
+
+  if (eindex < elen && findex < flen)
+    {
+      if ((fnow > enow) == (fnow > -enow))
+        {
+          p2t_fast_two_sum (enow, q, &qnew, &hh);
+          enow = (++eindex < elen) ? e[eindex] : 0;
+        }
+      else
+        {
+          p2t_fast_two_sum (fnow, q, &qnew, &hh);
+          fnow = (++findex < flen) ? f[findex] : 0;
+        }
+      q = qnew;
+      if (hh != 0.0)
+        h[hindex++] = hh;
+
+      while (eindex < elen && findex < flen)
+        {
+          if ((fnow > enow) == (fnow > -enow))
+            {
+              p2t_two_sum (q, enow, &qnew, &hh);
+              enow = (++eindex < elen) ? e[eindex] : 0;
+            }
+          else
+            {
+              p2t_two_sum (q, fnow, &qnew, &hh);
+              fnow = (++findex < flen) ? f[findex] : 0;
+            }
+          q = qnew;
+          if (hh != 0.0)
+            h[hindex++] = hh;
+        }
+    }
+
+  while (eindex < elen)
+    {
+      p2t_two_sum (q, enow, &qnew, &hh);
+      enow = (++eindex < elen) ? e[eindex] : 0;
+      q = qnew;
+      if (hh != 0.0)
+        h[hindex++] = hh;
+    }
+
+  while (findex < flen)
+    {
+      p2t_two_sum (q, fnow, &qnew, &hh);
+      fnow = (++findex < flen) ? f[findex] : 0;
+      q = qnew;
+      if (hh != 0.0)
+        h[hindex++] = hh;
+    }
+
+  if (q != 0.0 || hindex == 0)
+    h[hindex++] = q;
+  return hindex;
+}
+
+/* h = e * b, where e is an expansion. Returns the length of h */
+static int
+p2t_expansion_scale (int elen, const double *e, double b, double *h)
+{
+  double q, sum, hh, product1, product0, bhi, blo;
+  int eindex, hindex = 0;
+
+  p2t_split (b, &bhi, &blo);
+  p2t_two_product_presplit (e[0], b, bhi, blo, &q, &hh);
+  if (hh != 0.0)
+    h[hindex++] = hh;
+
+  for (eindex = 1; eindex < elen; eindex++)
+    {
+      p2t_two_product_presplit (e[eindex], b, bhi, blo, &product1, &product0);
+      p2t_two_sum (q, product0, &sum, &hh);
+      if (hh != 0.0)
+        h[hindex++] = hh;
+      p2t_fast_two_sum (product1, sum, &q, &hh);
+      if (hh != 0.0)
+        h[hindex++] = hh;
+    }
+
+  if (q != 0.0 || hindex == 0)
+    h[hindex++] = q;
+  return hindex;
+}
+
+/* The approximate value of an expansion */
+static double
+p2t_expansion_estimate (int elen, const double *e)
+{
+  double q = e[0];
+  int i;
+
+  for (i = 1; i < elen; i++)
+    q += e[i];
+  return q;
+}
+
+/* Stages B, C and D of the orientation test, once the floating point
+ * result was found to be too close to zero */
+static double
+p2t_orient2d_adapt (const P2tPoint* pa, const P2tPoint* pb, const P2tPoint* pc, double detsum)
+{
+  double acx = pa->x - pc->x, bcx = pb->x - pc->x;
+  double acy = pa->y - pc->y, bcy = pb->y - pc->y;
+  double acxtail, acytail, bcxtail, bcytail;
+  double B[4], C1[8], C2[12], D[16], u[4];
+  double det, errbound;
+  int c1len, c2len, dlen;
+
+  // Stage B: the exact determinant of the rounded differences
+  p2t_product_expansion (acx, bcy, acy, bcx, B);
+  det = p2t_expansion_estimate (4, B);
+  errbound = P2T_ORIENT_ERRBOUND_B * detsum;
+  if (det >= errbound || -det >= errbound)
+    return det;
+
+  // Stage C: correct it by the first order terms of the rounding errors of
+  // the differences
+  p2t_two_diff_tail (pa->x, pc->x, acx, &acxtail);
+  p2t_two_diff_tail (pb->x, pc->x, bcx, &bcxtail);
+  p2t_two_diff_tail (pa->y, pc->y, acy, &acytail);
+  p2t_two_diff_tail (pb->y, pc->y, bcy, &bcytail);
+
+  if (acxtail == 0.0 && acytail == 0.0 && bcxtail == 0.0 && bcytail == 0.0)
+    return det;
+
+  errbound = P2T_ORIENT_ERRBOUND_C * detsum + P2T_RESULT_ERRBOUND * fabs (det);
+  det += (acx * bcytail + bcy * acxtail) - (acy * bcxtail + bcx * acytail);
+  if (det >= errbound || -det >= errbound)
+    return det;
+
+  // Stage D: add all the error terms exactly
+  p2t_product_expansion (acxtail, bcy, acytail, bcx, u);
+  c1len = p2t_expansion_sum (4, B, 4, u, C1);
+  p2t_product_expansion (acx, bcytail, acy, bcxtail, u);
+  c2len = p2t_expansion_sum (c1len, C1, 4, u, C2);
+  p2t_product_expansion (acxtail, bcytail, acytail, bcxtail, u);
+  dlen = p2t_expansion_sum (c2len, C2, 4, u, D);
+
+  // The most significant component of an expansion has its sign
+  return D[dlen - 1];
+}
+
+/* The lifted determinant of one point, times the orientation of the other
+ * three: (px^2 + py^2) * sign * det */
+static int
+p2t_incircle_term (const double *det, int len, const P2tPoint* p, double sign, double *h)
+{
+  double t24x[24], t48x[48], t24y[24], t48y[48];
+  int xlen, ylen;
+
+  xlen = p2t_expansion_scale (len, det, p->x, t24x);
+  xlen = p2t_expansion_scale (xlen, t24x, sign * p->x, t48x);
+  ylen = p2t_expansion_scale (len, det, p->y, t24y);
+  ylen = p2t_expansion_scale (ylen, t24y, sign * p->y, t48y);
+  return p2t_expansion_sum (xlen, t48x, ylen, t48y, h);
+}
+
+static double
+p2t_incircle_exact (const P2tPoint* pa, const P2tPoint* pb, const P2tPoint* pc, const P2tPoint* pd)
+{
+  double ab[4], bc[4], cd[4], da[4], ac[4], bd[4], temp8[8];
+  double abc[12], bcd[12], cda[12], dab[12];
+  double adet[96], bdet[96], cdet[96], ddet[96];
+  double abdet[192], cddet[192], deter[384];
+  int templen, abclen, bcdlen, cdalen, dablen;
+  int alen, blen, clen, dlen, ablen, cdlen, deterlen;
+  int i;
+
+  p2t_product_expansion (pa->x, pb->y, pb->x, pa->y, ab);
+  p2t_product_expansion (pb->x, pc->y, pc->x, pb->y, bc);
+  p2t_product_expansion (pc->x, pd->y, pd->x, pc->y, cd);
+  p2t_product_expansion (pd->x, pa->y, pa->x, pd->y, da);
+  p2t_product_expansion (pa->x, pc->y, pc->x, pa->y, ac);
+  p2t_product_expansion (pb->x, pd->y, pd->x, pb->y, bd);
+
+  templen = p2t_expansion_sum (4, cd, 4, da, temp8);
+  cdalen = p2t_expansion_sum (templen, temp8, 4, ac, cda);
+  templen = p2t_expansion_sum (4, da, 4, ab, temp8);
+  dablen = p2t_expansion_sum (templen, temp8, 4, bd, dab);
+  for (i = 0; i < 4; i++)
+    {
+      bd[i] = -bd[i];
+      ac[i] = -ac[i];
+    }
+  templen = p2t_expansion_sum (4, ab, 4, bc, temp8);
+  abclen = p2t_expansion_sum (templen, temp8, 4, ac, abc);
+  templen = p2t_expansion_sum (4, bc, 4, cd, temp8);
+  bcdlen = p2t_expansion_sum (templen, temp8, 4, bd, bcd);
+
+  alen = p2t_incircle_term (bcd, bcdlen, pa, 1, adet);
+  blen = p2t_incircle_term (cda, cdalen, pb, -1, bdet);
+  clen = p2t_incircle_term (dab, dablen, pc, 1, cdet);
+  dlen = p2t_incircle_term (abc, abclen, pd, -1, ddet);
+
+  ablen = p2t_expansion_sum (alen, adet, blen, bdet, abdet);
+  cdlen = p2t_expansion_sum (clen, cdet, dlen, ddet, cddet);
+  deterlen = p2t_expansion_sum (ablen, abdet, cdlen, cddet, deter);
+
+  return deter[deterlen - 1];
+}
+
+/* The lifted determinant of one point of the in-circle test, from the
+ * exact 2x2 determinant of the two other points: (dx^2 + dy^2) * det */
+static int
+p2t_incircle_lift (const double *det, double dx, double dy, double *h)
+{
+  double tx[8], txx[16], ty[8], tyy[16];
+  int xlen, xxlen, ylen, yylen;
+
+  xlen = p2t_expansion_scale (4, det, dx, tx);
+  xxlen = p2t_expansion_scale (xlen, tx, dx, txx);
+  ylen = p2t_expansion_scale (4, det, dy, ty);
+  yylen = p2t_expansion_scale (ylen, ty, dy, tyy);
+  return p2t_expansion_sum (xxlen, txx, yylen, tyy, h);
+}
+
+/* Stages B and C of the in-circle test, once the floating point result was
+ * found to be too close to zero. The few cases which they can't settle are
+ * evaluated exactly */
+static double
+p2t_incircle_adapt (const P2tPoint* pa, const P2tPoint* pb, const P2tPoint* pc, const P2tPoint* pd,
+    double permanent)
+{
+  double adx = pa->x - pd->x, bdx = pb->x - pd->x, cdx = pc->x - pd->x;
+  double ady = pa->y - pd->y, bdy = pb->y - pd->y, cdy = pc->y - pd->y;
+  double adxtail, bdxtail, cdxtail, adytail, bdytail, cdytail;
+  double bc[4], ca[4], ab[4], adet[32], bdet[32], cdet[32], abdet[64], fin[96];
+  double det, errbound;
+  int alen, blen, clen, ablen, finlen;
+
+  // Stage B: the exact determinant of the rounded differences
+  p2t_product_expansion (bdx, cdy, cdx, bdy, bc);
+  alen = p2t_incircle_lift (bc, adx, ady, adet);
+  p2t_product_expansion (cdx, ady, adx, cdy, ca);
+  blen = p2t_incircle_lift (ca, bdx, bdy, bdet);
+  p2t_product_expansion (adx, bdy, bdx, ady, ab);
+  clen = p2t_incircle_lift (ab, cdx, cdy, cdet);
+
+  ablen = p2t_expansion_sum (alen, adet, blen, bdet, abdet);
+  finlen = p2t_expansion_sum (ablen, abdet, clen, cdet, fin);
+
+  det = p2t_expansion_estimate (finlen, fin);
+  errbound = P2T_INCIRCLE_ERRBOUND_B * permanent;
+  if (det >= errbound || -det >= errbound)
+    return det;
+
+  // Stage C: correct it by the first order terms of the rounding errors of
+  // the differences
+  p2t_two_diff_tail (pa->x, pd->x, adx, &adxtail);
+  p2t_two_diff_tail (pa->y, pd->y, ady, &adytail);
+  p2t_two_diff_tail (pb->x, pd->x, bdx, &bdxtail);
+  p2t_two_diff_tail (pb->y, pd->y, bdy, &bdytail);
+  p2t_two_diff_tail (pc->x, pd->x, cdx, &cdxtail);
+  p2t_two_diff_tail (pc->y, pd->y, cdy, &cdytail);
+
+  if (adxtail == 0.0 && bdxtail == 0.0 && cdxtail == 0.0
+      && adytail == 0.0 && bdytail == 0.0 && cdytail == 0.0)
+    return det;
+
+  errbound = P2T_INCIRCLE_ERRBOUND_C * permanent + P2T_RESULT_ERRBOUND * fabs (det);
+  det += ((adx * adx + ady * ady) * ((bdx * cdytail + cdy * bdxtail) - (bdy * cdxtail + cdx * bdytail))
+          + 2.0 * (adx * adxtail + ady * adytail) * (bdx * cdy - bdy * cdx))
+       + ((bdx * bdx + bdy * bdy) * ((cdx * adytail + ady * cdxtail) - (cdy * adxtail + adx * cdytail))
+          + 2.0 * (bdx * bdxtail + bdy * bdytail) * (cdx * ady - cdy * adx))
+       + ((cdx * cdx + cdy * cdy) * ((adx * bdytail + bdy * adxtail) - (ady * bdxtail + bdx * adytail))
+          + 2.0 * (cdx * cdxtail + cdy * cdytail) * (adx * bdy - ady * bdx));
+  if (det >= errbound || -det >= errbound)
+    return det;
+
+  return p2t_incircle_exact (pa, pb, pc, pd);
+}
+
+double
+p2t_utils_orient2d (const P2tPoint* pa, const P2tPoint* pb, const P2tPoint* pc)
+{
+  double detleft = (pa->x - pc->x) * (pb->y - pc->y);
+  double detright = (pa->y - pc->y) * (pb->x - pc->x);
+  double det = detleft - detright;
+  double detsum;
+
+  // If both products have different signs (or one is zero), there can be
+  // no cancellation and the rounded result has the right sign
+  if (detleft > 0)
+    {
+      if (detright <= 0)
+        return det;
+      detsum = detleft + detright;
+    }
+  else if (detleft < 0)
+    {
+      if (detright >= 0)
+        return det;
+      detsum = -detleft - detright;
+    }
+  else
+    return det;
+
+  if (fabs (det) >= P2T_ORIENT_ERRBOUND * detsum)
+    return det;
+
+  return p2t_orient2d_adapt (pa, pb, pc, detsum);
+}
+
+double
+p2t_utils_incircle (const P2tPoint* pa, const P2tPoint* pb, const P2tPoint* pc, const P2tPoint* pd)
+{
+  double adx = pa->x - pd->x;
+  double bdx = pb->x - pd->x;
+  double cdx = pc->x - pd->x;
+  double ady = pa->y - pd->y;
+  double bdy = pb->y - pd->y;
+  double cdy = pc->y - pd->y;
+
+  double bdxcdy = bdx * cdy;
+  double cdxbdy = cdx * bdy;
+  double alift = adx * adx + ady * ady;
+
+  double cdxady = cdx * ady;
+  double adxcdy = adx * cdy;
+  double blift = bdx * bdx + bdy * bdy;
+
+  double adxbdy = adx * bdy;
+  double bdxady = bdx * ady;
+  double clift = cdx * cdx + cdy * cdy;
+
+  double det = alift * (bdxcdy - cdxbdy) + blift * (cdxady - adxcdy) + clift * (adxbdy - bdxady);
+
+  double permanent = (fabs (bdxcdy) + fabs (cdxbdy)) * alift
+                   + (fabs (cdxady) + fabs (adxcdy)) * blift
+                   + (fabs (adxbdy) + fabs (bdxady)) * clift;
+
+  if (fabs (det) > P2T_INCIRCLE_ERRBOUND * permanent)
+    return det;
+
+  return p2t_incircle_adapt (pa, pb, pc, pd, permanent);
+}
+
 /**
  * Forumla to calculate signed area<br>
  * Positive if CCW<br>
@@ -46,10 +529,8 @@
 P2tOrientation
 p2t_orient2d (P2tPoint* pa, P2tPoint* pb, P2tPoint* pc)
 {
-  double detleft = (pa->x - pc->x) * (pb->y - pc->y);
-  double detright = (pa->y - pc->y) * (pb->x - pc->x);
-  double val = detleft - detright;
-  if (val > -EPSILON && val < EPSILON)
+  double val = p2t_utils_orient2d (pa, pb, pc);
+  if (val == 0)
     {
       return COLLINEAR;
     }
@@ -63,30 +544,14 @@ p2t_orient2d (P2tPoint* pa, P2tPoint* pb, P2tPoint* pc)
 gboolean
 p2t_utils_in_scan_area (P2tPoint* pa, P2tPoint* pb, P2tPoint* pc, P2tPoint* pd)
 {
-  double pdx = pd->x;
-  double pdy = pd->y;
-  double adx = pa->x - pdx;
-  double ady = pa->y - pdy;
-  double bdx = pb->x - pdx;
-  double bdy = pb->y - pdy;
-
-  double adxbdy = adx * bdy;
-  double bdxady = bdx * ady;
-  double oabd = adxbdy - bdxady;
-
-  if (oabd <= EPSILON)
+  // pd must be strictly to the left of pa->pb, and strictly to the right of
+  // pa->pc (as seen from pa)
+  if (p2t_utils_orient2d (pa, pb, pd) <= 0)
     {
       return FALSE;
     }
 
-  double cdx = pc->x - pdx;
-  double cdy = pc->y - pdy;
-
-  double cdxady = cdx * ady;
-  double adxcdy = adx * cdy;
-  double ocad = cdxady - adxcdy;
-
-  if (ocad <= EPSILON)
+  if (p2t_utils_orient2d (pc, pa, pd) <= 0)
     {
       return FALSE;
     }
@@ -59,5 +59,19 @@ P2tOrientation p2t_orient2d (P2tPoint* pa, P2tPoint* pb, P2tPoint* pc);
 
 gboolean p2t_utils_in_scan_area (P2tPoint* pa, P2tPoint* pb, P2tPoint* pc, P2tPoint* pd);
 
+/**
+ * Robust orientation test - a value whose sign is exactly the sign of
+ * (pa - pc) x (pb - pc): positive if pa, pb, pc are in CCW order, negative
+ * if they are in CW order and zero if they are exactly collinear
+ */
+double p2t_utils_orient2d (const P2tPoint* pa, const P2tPoint* pb, const P2tPoint* pc);
+
+/**
+ * Robust incircle test - a value which is positive if pd lies inside the
+ * circle passing through pa, pb and pc (given in CCW order), negative if it
+ * lies outside and zero if the four points are exactly cocircular
+ */
+double p2t_utils_incircle (const P2tPoint* pa, const P2tPoint* pb, const P2tPoint* pc, const P2tPoint* pd);
+
 #endif
 
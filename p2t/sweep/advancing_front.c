@@ -38,6 +38,7 @@ p2t_node_init_pt (P2tNode* THIS, P2tPoint* p)
   THIS->value = p->x;
   THIS->next = NULL;
   THIS->prev = NULL;
+  THIS->index_iter = NULL;
 }
 
 P2tNode*
@@ -56,6 +57,7 @@ p2t_node_init_pt_tr (P2tNode* THIS, P2tPoint* p, P2tTriangle* t)
   THIS->value = p->x;
   THIS->next = NULL;
   THIS->prev = NULL;
+  THIS->index_iter = NULL;
 }
 
 P2tNode*
@@ -78,9 +80,16 @@ void p2t_node_free (P2tNode* THIS)
 void
 p2t_advancingfront_init (P2tAdvancingFront* THIS, P2tNode* head, P2tNode* tail)
 {
+  P2tNode* node;
+
   THIS->head_ = head;
   THIS->tail_ = tail;
   THIS->search_node_ = head;
+  THIS->locate_steps_ = 0;
+
+  THIS->index_ = g_sequence_new (NULL);
+  for (node = head; node != NULL; node = node->next)
+    node->index_iter = g_sequence_append (THIS->index_, node);
 }
 
 P2tAdvancingFront*
@@ -92,7 +101,10 @@ p2t_advancingfront_new (P2tNode* head, P2tNode* tail)
 }
 
 void
-p2t_advancingfront_destroy (P2tAdvancingFront* THIS) { }
+p2t_advancingfront_destroy (P2tAdvancingFront* THIS)
+{
+  g_sequence_free (THIS->index_);
+}
 
 void
 p2t_advancingfront_free (P2tAdvancingFront* THIS)
@@ -104,38 +116,63 @@ p2t_advancingfront_free (P2tAdvancingFront* THIS)
 P2tNode*
 p2t_advancingfront_locate_node (P2tAdvancingFront *THIS, const double x)
 {
-  P2tNode* node = THIS->search_node_;
+  P2tNode* node = p2t_advancingfront_find_search_node (THIS, x);
 
-  if (x < node->value)
-    {
-      while ((node = node->prev) != NULL)
-        {
-          if (x >= node->value)
-            {
-              THIS->search_node_ = node;
-              return node;
-            }
-        }
-    }
+  // The search node is the rightmost one with a value <= x, so it is the
+  // node below x unless x is outside of the front
+  if (x < node->value || node->next == NULL)
+    return NULL;
+
+  THIS->search_node_ = node;
+  return node;
+}
+
+/* The node searched for in the index, along with the front for counting
+ * the comparisons. The node must come first, as it is compared by address */
+typedef struct
+{
+  P2tNode node;
+  P2tAdvancingFront* front;
+} P2tAdvancingFrontQuery;
+
+/* Order nodes by their value. The searched node (passed as the user data)
+ * is considered larger than all the nodes with the same value, so that a
+ * search always ends right after the last node whose value is <= x */
+static gint
+p2t_advancingfront_index_cmp (gconstpointer a, gconstpointer b, gpointer query)
+{
+  const P2tNode* n1 = (const P2tNode*) a;
+  const P2tNode* n2 = (const P2tNode*) b;
+
+  P2T_ADVANCINGFRONT_STEP (((P2tAdvancingFrontQuery*) query)->front);
+
+  if (n1->value < n2->value)
+    return -1;
+  else if (n1->value > n2->value)
+    return 1;
+  else if (n1 == query)
+    return 1;
+  else if (n2 == query)
+    return -1;
   else
-    {
-      while ((node = node->next) != NULL)
-        {
-          if (x < node->value)
-            {
-              THIS->search_node_ = node->prev;
-              return node->prev;
-            }
-        }
-    }
-  return NULL;
+    return 0;
 }
 
 P2tNode*
 p2t_advancingfront_find_search_node (P2tAdvancingFront *THIS, const double x)
 {
-  // TODO: implement BST index
-  return THIS->search_node_;
+  P2tAdvancingFrontQuery query;
+  GSequenceIter *iter;
+
+  query.node.value = x;
+  query.front = THIS;
+  iter = g_sequence_search (THIS->index_, &query, p2t_advancingfront_index_cmp, &query);
+
+  // x is to the left of the whole front
+  if (g_sequence_iter_is_begin (iter))
+    return THIS->head_;
+
+  return (P2tNode*) g_sequence_get (g_sequence_iter_prev (iter));
 }
 
 P2tNode*
@@ -164,23 +201,11 @@ p2t_advancingfront_locate_point (P2tAdvancingFront *THIS, const P2tPoint* point)
             }
         }
     }
-  else if (px < nx)
-    {
-      while ((node = node->prev) != NULL)
-        {
-          if (point == node->point)
-            {
-              break;
-            }
-        }
-    }
   else
     {
-      while ((node = node->next) != NULL)
-        {
-          if (point == node->point)
-            break;
-        }
+      // The search node is the rightmost one with a value <= px, so no node
+      // with the x of the point is on the front
+      node = NULL;
     }
   if (node) THIS->search_node_ = node;
   return node;
@@ -222,3 +247,26 @@ p2t_advancingfront_set_search (P2tAdvancingFront *THIS, P2tNode* node)
   THIS->search_node_ = node;
 }
 
+void
+p2t_advancingfront_insert_after (P2tAdvancingFront *THIS, P2tNode* node, P2tNode* new_node)
+{
+  new_node->next = node->next;
+  new_node->prev = node;
+  node->next->prev = new_node;
+  node->next = new_node;
+
+  new_node->index_iter = g_sequence_insert_before (new_node->next->index_iter, new_node);
+}
+
+void
+p2t_advancingfront_remove (P2tAdvancingFront *THIS, P2tNode* node)
+{
+  node->prev->next = node->next;
+  node->next->prev = node->prev;
+
+  g_sequence_remove (node->index_iter);
+  node->index_iter = NULL;
+
+  if (THIS->search_node_ == node)
+    THIS->search_node_ = node->prev;
+}
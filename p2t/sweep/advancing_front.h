@@ -46,6 +46,10 @@ struct _P2tNode
   struct _P2tNode* prev;
 
   double value;
+
+  /** The position of the node in the index of the advancing front, or NULL
+   *  if the node is not a part of the front */
+  GSequenceIter* index_iter;
 };
 
 void p2t_node_init_pt (P2tNode* THIS, P2tPoint* p);
@@ -63,8 +67,22 @@ struct AdvancingFront_
 
   P2tNode* head_, *tail_, *search_node_;
 
+  /** All the nodes of the front, ordered by their value. Allows locating
+   *  nodes without walking along the front */
+  GSequence* index_;
+
+  /** The comparisons made by the searches of the index, only counted when
+   *  built with P2T_SWEEP_STATS */
+  guint64 locate_steps_;
+
 };
 
+#ifdef P2T_SWEEP_STATS
+#define P2T_ADVANCINGFRONT_STEP(front) ((front)->locate_steps_++)
+#else
+#define P2T_ADVANCINGFRONT_STEP(front) ((void) 0)
+#endif
+
 void p2t_advancingfront_init (P2tAdvancingFront* THIS, P2tNode* head, P2tNode* tail);
 P2tAdvancingFront* p2t_advancingfront_new (P2tNode* head, P2tNode* tail);
 
@@ -78,11 +96,18 @@ void p2t_advancingfront_set_tail (P2tAdvancingFront *THIS, P2tNode* node);
 P2tNode* p2t_advancingfront_search (P2tAdvancingFront *THIS);
 void p2t_advancingfront_set_search (P2tAdvancingFront *THIS, P2tNode* node);
 
+/** Link new_node into the front right after node */
+void p2t_advancingfront_insert_after (P2tAdvancingFront *THIS, P2tNode* node, P2tNode* new_node);
+
+/** Unlink a node from the front. The node itself is not freed */
+void p2t_advancingfront_remove (P2tAdvancingFront *THIS, P2tNode* node);
+
 /** Locate insertion point along advancing front */
 P2tNode* p2t_advancingfront_locate_node (P2tAdvancingFront *THIS, const double x);
 
 P2tNode* p2t_advancingfront_locate_point (P2tAdvancingFront *THIS, const P2tPoint* point);
 
+/** Find the rightmost node whose value is not larger than x, in O(log n) */
 P2tNode* p2t_advancingfront_find_search_node (P2tAdvancingFront *THIS, const double x);
 
 #endif
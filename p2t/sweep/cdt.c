@@ -29,27 +29,438 @@
  * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 #include "cdt.h"
+#include "../common/arena.h"
+
+/* One outer polyline of a CDT made of several of them (see
+ * #p2t_cdt_new_multi), along with its holes and Steiner points */
+typedef struct
+{
+  /* The CDT triangulating the component. The first component is triangulated
+   * by the CDT which owns all the components */
+  P2tCDT* cdt;
+  P2tPointPtrArray outline;
+  /* How many other polylines surround the outline */
+  guint depth;
+  double min_x, min_y, max_x, max_y;
+  /* For each point given to the CDT of the component, in order, its index
+   * among all the points given to the owning CDT */
+  GArray* input_index;
+} P2tCDTComponent;
+
+/* A uniform grid over a set of bounding boxes. Each cell lists the boxes
+ * overlapping it, in increasing order: the boxes of the cell (i, j) are the
+ * entries of items from offsets[j * cols + i] up to
+ * offsets[j * cols + i + 1] */
+struct P2tCDTGrid_
+{
+  double min_x, min_y, max_x, max_y, cell_w, cell_h;
+  guint cols, rows;
+  guint32* offsets;
+  guint32* items;
+};
+typedef struct P2tCDTGrid_ P2tCDTGrid;
 
 void
 p2t_cdt_init (P2tCDT* THIS, P2tPointPtrArray polyline)
 {
-  THIS->sweep_context_ = p2t_sweepcontext_new (polyline);
-  THIS->sweep_ = p2t_sweep_new ();
+  p2t_cdt_init_full (THIS, polyline, P2T_CDT_DEFAULT);
 }
 
 P2tCDT*
 p2t_cdt_new (P2tPointPtrArray polyline)
+{
+  return p2t_cdt_new_full (polyline, P2T_CDT_DEFAULT);
+}
+
+void
+p2t_cdt_init_full (P2tCDT* THIS, P2tPointPtrArray polyline, P2tCDTFlags flags)
+{
+  THIS->arena_ = (flags & P2T_CDT_USE_ARENA) ? p2t_arena_new () : NULL;
+  THIS->sweep_context_ = p2t_sweepcontext_new (polyline, THIS->arena_);
+  THIS->sweep_ = p2t_sweep_new ();
+  THIS->xy_polylines_ = NULL;
+  THIS->components_ = NULL;
+  THIS->component_grid_ = NULL;
+  THIS->multi_triangles_ = NULL;
+  THIS->multi_map_ = NULL;
+  THIS->n_inputs_ = 0;
+}
+
+P2tCDT*
+p2t_cdt_new_full (P2tPointPtrArray polyline, P2tCDTFlags flags)
 {
   P2tCDT* THIS = g_slice_new (P2tCDT);
-  p2t_cdt_init (THIS, polyline);
+  p2t_cdt_init_full (THIS, polyline, flags);
   return THIS;
 }
 
+// A point is nothing but its two coordinates, so the points of the buffer
+// can be used as they are
+G_STATIC_ASSERT (sizeof (P2tPoint) == 2 * sizeof (double));
+G_STATIC_ASSERT (G_STRUCT_OFFSET (P2tPoint, y) == sizeof (double));
+
+P2tCDT*
+p2t_cdt_new_from_xy (const double *xy, gsize stride, gsize n_points,
+                     const gsize *hole_offsets, gsize n_holes,
+                     P2tCDTFlags flags)
+{
+  P2tCDT* THIS;
+  GPtrArray* polylines = g_ptr_array_new_full (n_holes + 1, (GDestroyNotify) g_ptr_array_unref);
+  gsize i, j, start = 0;
+
+  for (i = 0; i <= n_holes; i++)
+    {
+      gsize end = (i < n_holes) ? hole_offsets[i] : n_points;
+      P2tPointPtrArray polyline = g_ptr_array_sized_new (end - start);
+
+      assert (start <= end && end <= n_points);
+      g_ptr_array_set_size (polyline, end - start);
+      for (j = start; j < end; j++)
+        polyline->pdata[j - start] = (P2tPoint*) (xy + j * stride);
+
+      g_ptr_array_add (polylines, polyline);
+      start = end;
+    }
+
+  THIS = p2t_cdt_new_full ((P2tPointPtrArray) g_ptr_array_index (polylines, 0), flags);
+  for (i = 1; i <= n_holes; i++)
+    p2t_cdt_add_hole (THIS, (P2tPointPtrArray) g_ptr_array_index (polylines, i));
+
+  THIS->xy_polylines_ = polylines;
+  return THIS;
+}
+
+/* Does the polyline (whose bounding box is given) contain the point? Uses the
+ * even-odd rule, so the orientation of the polyline doesn't matter */
+static gboolean
+p2t_cdt_polyline_contains (P2tPointPtrArray polyline, double min_x, double min_y, double max_x, double max_y, const P2tPoint* p)
+{
+  gboolean inside = FALSE;
+  guint i, j;
+
+  if (p->x < min_x || p->x > max_x || p->y < min_y || p->y > max_y)
+    return FALSE;
+
+  for (i = 0, j = polyline->len - 1; i < polyline->len; j = i++)
+    {
+      const P2tPoint *a = point_index (polyline, i), *b = point_index (polyline, j);
+      if ((a->y > p->y) != (b->y > p->y)
+          && p->x < (b->x - a->x) * (p->y - a->y) / (b->y - a->y) + a->x)
+        inside = !inside;
+    }
+  return inside;
+}
+
+static void
+p2t_cdt_polyline_bounds (P2tPointPtrArray polyline, double *min_x, double *min_y, double *max_x, double *max_y)
+{
+  guint i;
+
+  *min_x = *max_x = point_index (polyline, 0)->x;
+  *min_y = *max_y = point_index (polyline, 0)->y;
+  for (i = 1; i < polyline->len; i++)
+    {
+      const P2tPoint* p = point_index (polyline, i);
+      *min_x = MIN (*min_x, p->x);
+      *max_x = MAX (*max_x, p->x);
+      *min_y = MIN (*min_y, p->y);
+      *max_y = MAX (*max_y, p->y);
+    }
+}
+
+static guint
+p2t_cdt_grid_cell (double v, double min, double size, guint count)
+{
+  double cell = (v - min) / size;
+  return (cell <= 0) ? 0 : MIN ((guint) cell, count - 1);
+}
+
+/* A grid over n boxes, given as (min x, min y, max x, max y). There are
+ * about as many cells as boxes, so that boxes which are spread out share
+ * few cells */
+static P2tCDTGrid*
+p2t_cdt_grid_new (const double* bounds, guint n)
+{
+  P2tCDTGrid* THIS = g_slice_new (P2tCDTGrid);
+  guint *cursors, i, x, y;
+
+  THIS->min_x = bounds[0];
+  THIS->min_y = bounds[1];
+  THIS->max_x = bounds[2];
+  THIS->max_y = bounds[3];
+  for (i = 1; i < n; i++)
+    {
+      THIS->min_x = MIN (THIS->min_x, bounds[4 * i]);
+      THIS->min_y = MIN (THIS->min_y, bounds[4 * i + 1]);
+      THIS->max_x = MAX (THIS->max_x, bounds[4 * i + 2]);
+      THIS->max_y = MAX (THIS->max_y, bounds[4 * i + 3]);
+    }
+
+  THIS->cols = THIS->rows = MAX (1, (guint) ceil (sqrt (n)));
+  THIS->cell_w = (THIS->max_x > THIS->min_x) ? (THIS->max_x - THIS->min_x) / THIS->cols : 1;
+  THIS->cell_h = (THIS->max_y > THIS->min_y) ? (THIS->max_y - THIS->min_y) / THIS->rows : 1;
+
+  // The cells covered by each box, as (x0, y0, x1, y1)
+  cursors = g_new (guint, 4 * n);
+  for (i = 0; i < n; i++)
+    {
+      cursors[4 * i] = p2t_cdt_grid_cell (bounds[4 * i], THIS->min_x, THIS->cell_w, THIS->cols);
+      cursors[4 * i + 1] = p2t_cdt_grid_cell (bounds[4 * i + 1], THIS->min_y, THIS->cell_h, THIS->rows);
+      cursors[4 * i + 2] = p2t_cdt_grid_cell (bounds[4 * i + 2], THIS->min_x, THIS->cell_w, THIS->cols);
+      cursors[4 * i + 3] = p2t_cdt_grid_cell (bounds[4 * i + 3], THIS->min_y, THIS->cell_h, THIS->rows);
+    }
+
+  // Count the boxes of each cell, then place them, using the offsets as
+  // insertion cursors which are restored after
+  THIS->offsets = g_new0 (guint32, THIS->cols * THIS->rows + 1);
+  for (i = 0; i < n; i++)
+    for (y = cursors[4 * i + 1]; y <= cursors[4 * i + 3]; y++)
+      for (x = cursors[4 * i]; x <= cursors[4 * i + 2]; x++)
+        THIS->offsets[y * THIS->cols + x + 1]++;
+
+  for (x = 0; x < THIS->cols * THIS->rows; x++)
+    THIS->offsets[x + 1] += THIS->offsets[x];
+
+  THIS->items = g_new (guint32, THIS->offsets[THIS->cols * THIS->rows]);
+  for (i = 0; i < n; i++)
+    for (y = cursors[4 * i + 1]; y <= cursors[4 * i + 3]; y++)
+      for (x = cursors[4 * i]; x <= cursors[4 * i + 2]; x++)
+        THIS->items[THIS->offsets[y * THIS->cols + x]++] = i;
+
+  for (x = THIS->cols * THIS->rows; x > 0; x--)
+    THIS->offsets[x] = THIS->offsets[x - 1];
+  THIS->offsets[0] = 0;
+
+  g_free (cursors);
+  return THIS;
+}
+
+static void
+p2t_cdt_grid_free (P2tCDTGrid* THIS)
+{
+  g_free (THIS->offsets);
+  g_free (THIS->items);
+  g_slice_free (P2tCDTGrid, THIS);
+}
+
+/* The boxes which may contain the point, in increasing order */
+static const guint32*
+p2t_cdt_grid_find (P2tCDTGrid* THIS, const P2tPoint* p, guint* count)
+{
+  guint cell;
+
+  if (p->x < THIS->min_x || p->x > THIS->max_x || p->y < THIS->min_y || p->y > THIS->max_y)
+    {
+      *count = 0;
+      return NULL;
+    }
+
+  cell = p2t_cdt_grid_cell (p->y, THIS->min_y, THIS->cell_h, THIS->rows) * THIS->cols
+       + p2t_cdt_grid_cell (p->x, THIS->min_x, THIS->cell_w, THIS->cols);
+  *count = THIS->offsets[cell + 1] - THIS->offsets[cell];
+  return THIS->items + THIS->offsets[cell];
+}
+
+/* The innermost component whose outline contains the point, or NULL */
+static P2tCDTComponent*
+p2t_cdt_find_component (P2tCDT* THIS, const P2tPoint* p)
+{
+  P2tCDTComponent* found = NULL;
+  const guint32* candidates;
+  guint i, count;
+
+  candidates = p2t_cdt_grid_find (THIS->component_grid_, p, &count);
+  for (i = 0; i < count; i++)
+    {
+      P2tCDTComponent* c = (P2tCDTComponent*) g_ptr_array_index (THIS->components_, candidates[i]);
+      if ((found == NULL || c->depth > found->depth)
+          && p2t_cdt_polyline_contains (c->outline, c->min_x, c->min_y, c->max_x, c->max_y, p))
+        found = c;
+    }
+  return found;
+}
+
+/* Record that the points from the given index up to n points later went to
+ * the component */
+static void
+p2t_cdt_component_add_range (P2tCDTComponent* c, guint32 first, guint n)
+{
+  guint i;
+
+  for (i = 0; i < n; i++)
+    {
+      guint32 index = first + i;
+      g_array_append_val (c->input_index, index);
+    }
+}
+
+/* Record that the next n points given to the CDT went to the component */
+static void
+p2t_cdt_component_add_inputs (P2tCDT* THIS, P2tCDTComponent* c, guint n)
+{
+  p2t_cdt_component_add_range (c, THIS->n_inputs_, n);
+  THIS->n_inputs_ += n;
+}
+
+P2tCDT*
+p2t_cdt_new_multi (GPtrArray* polylines, P2tCDTFlags flags)
+{
+  P2tCDT* THIS = NULL;
+  const guint n = polylines->len;
+  guint* depth = g_new0 (guint, n);
+  guint32* first = g_new (guint32, n);
+  double* bounds = g_new (double, 4 * n);
+  P2tCDTGrid* grid;
+  const guint32* candidates;
+  guint32 n_inputs = 0;
+  guint i, j, count;
+
+  for (i = 0; i < n; i++)
+    {
+      P2tPointPtrArray polyline = (P2tPointPtrArray) g_ptr_array_index (polylines, i);
+      p2t_cdt_polyline_bounds (polyline,
+          &bounds[4 * i], &bounds[4 * i + 1], &bounds[4 * i + 2], &bounds[4 * i + 3]);
+      first[i] = n_inputs;
+      n_inputs += polyline->len;
+    }
+
+  // The polylines don't cross each other, so one polyline is inside of
+  // another if any of its points is. Only the polylines sharing a cell of
+  // the grid with that point may contain it
+  grid = p2t_cdt_grid_new (bounds, n);
+  for (i = 0; i < n; i++)
+    {
+      const P2tPoint* p = point_index ((P2tPointPtrArray) g_ptr_array_index (polylines, i), 0);
+
+      candidates = p2t_cdt_grid_find (grid, p, &count);
+      for (j = 0; j < count; j++)
+        {
+          guint k = candidates[j];
+          if (k != i && p2t_cdt_polyline_contains ((P2tPointPtrArray) g_ptr_array_index (polylines, k),
+                    bounds[4 * k], bounds[4 * k + 1], bounds[4 * k + 2], bounds[4 * k + 3], p))
+            depth[i]++;
+        }
+    }
+  p2t_cdt_grid_free (grid);
+
+  // Each polyline surrounded by an even amount of others is an outline. The
+  // first one is triangulated by the returned CDT itself
+  for (i = 0; i < n; i++)
+    {
+      P2tPointPtrArray polyline = (P2tPointPtrArray) g_ptr_array_index (polylines, i);
+      P2tCDTComponent* c;
+
+      if (depth[i] % 2 != 0)
+        continue;
+
+      c = g_slice_new (P2tCDTComponent);
+      if (THIS == NULL)
+        {
+          THIS = p2t_cdt_new_full (polyline, flags);
+          THIS->components_ = g_ptr_array_new ();
+          THIS->multi_triangles_ = g_ptr_array_new ();
+          THIS->multi_map_ = g_ptr_array_new ();
+          c->cdt = THIS;
+        }
+      else
+        c->cdt = p2t_cdt_new_full (polyline, flags);
+
+      c->outline = g_ptr_array_sized_new (polyline->len);
+      g_ptr_array_set_size (c->outline, polyline->len);
+      memcpy (c->outline->pdata, polyline->pdata, polyline->len * sizeof (gpointer));
+      c->depth = depth[i];
+      c->min_x = bounds[4 * i];
+      c->min_y = bounds[4 * i + 1];
+      c->max_x = bounds[4 * i + 2];
+      c->max_y = bounds[4 * i + 3];
+      c->input_index = g_array_new (FALSE, FALSE, sizeof (guint32));
+      p2t_cdt_component_add_range (c, first[i], polyline->len);
+      g_ptr_array_add (THIS->components_, c);
+    }
+
+  assert (THIS != NULL);
+  THIS->n_inputs_ = n_inputs;
+
+  // Reuse the bounds for the grid of the components
+  for (i = 0; i < THIS->components_->len; i++)
+    {
+      P2tCDTComponent* c = (P2tCDTComponent*) g_ptr_array_index (THIS->components_, i);
+      bounds[4 * i] = c->min_x;
+      bounds[4 * i + 1] = c->min_y;
+      bounds[4 * i + 2] = c->max_x;
+      bounds[4 * i + 3] = c->max_y;
+    }
+  THIS->component_grid_ = p2t_cdt_grid_new (bounds, THIS->components_->len);
+
+  // Give each hole to the outline right around it
+  for (i = 0; i < n; i++)
+    {
+      P2tPointPtrArray polyline = (P2tPointPtrArray) g_ptr_array_index (polylines, i);
+      P2tCDTComponent* c = NULL;
+
+      if (depth[i] % 2 == 0)
+        continue;
+
+      candidates = p2t_cdt_grid_find (THIS->component_grid_, point_index (polyline, 0), &count);
+      for (j = 0; j < count; j++)
+        {
+          c = (P2tCDTComponent*) g_ptr_array_index (THIS->components_, candidates[j]);
+          if (c->depth == depth[i] - 1 && p2t_cdt_polyline_contains (c->outline,
+                  c->min_x, c->min_y, c->max_x, c->max_y, point_index (polyline, 0)))
+            break;
+        }
+      assert (j < count);
+
+      p2t_sweepcontext_add_hole (c->cdt->sweep_context_, polyline);
+      p2t_cdt_component_add_range (c, first[i], polyline->len);
+    }
+
+  g_free (depth);
+  g_free (first);
+  g_free (bounds);
+  return THIS;
+}
+
+static void
+p2t_cdt_free_components (P2tCDT* THIS)
+{
+  guint i;
+
+  if (THIS->components_ == NULL)
+    return;
+
+  for (i = 0; i < THIS->components_->len; i++)
+    {
+      P2tCDTComponent* c = (P2tCDTComponent*) g_ptr_array_index (THIS->components_, i);
+      if (c->cdt != THIS)
+        p2t_cdt_free (c->cdt);
+      g_ptr_array_free (c->outline, TRUE);
+      g_array_free (c->input_index, TRUE);
+      g_slice_free (P2tCDTComponent, c);
+    }
+
+  g_ptr_array_free (THIS->components_, TRUE);
+  p2t_cdt_grid_free (THIS->component_grid_);
+  g_ptr_array_free (THIS->multi_triangles_, TRUE);
+  g_ptr_array_free (THIS->multi_map_, TRUE);
+  THIS->components_ = NULL;
+  THIS->component_grid_ = NULL;
+  THIS->multi_triangles_ = NULL;
+  THIS->multi_map_ = NULL;
+  THIS->n_inputs_ = 0;
+}
+
 void
 p2t_cdt_destroy (P2tCDT* THIS)
 {
+  p2t_cdt_free_components (THIS);
   p2t_sweepcontext_delete (THIS->sweep_context_);
   p2t_sweep_free (THIS->sweep_);
+  if (THIS->xy_polylines_ != NULL)
+    g_ptr_array_unref (THIS->xy_polylines_);
+  // Must come last, the context may still refer to objects in the arena
+  if (THIS->arena_ != NULL)
+    p2t_arena_free (THIS->arena_);
 }
 
 void
@@ -59,32 +470,377 @@ p2t_cdt_free (P2tCDT* THIS)
   g_slice_free (P2tCDT, THIS);
 }
 
+void
+p2t_cdt_reset (P2tCDT *THIS, P2tPointPtrArray polyline)
+{
+  p2t_sweep_reset (THIS->sweep_);
+  // This also clears the arena
+  p2t_sweepcontext_reset (THIS->sweep_context_, polyline);
+  p2t_cdt_free_components (THIS);
+  if (THIS->xy_polylines_ != NULL)
+    {
+      g_ptr_array_unref (THIS->xy_polylines_);
+      THIS->xy_polylines_ = NULL;
+    }
+}
+
 void
 p2t_cdt_add_hole (P2tCDT *THIS, P2tPointPtrArray polyline)
 {
-  p2t_sweepcontext_add_hole (THIS->sweep_context_, polyline);
+  P2tCDTComponent* c;
+
+  if (THIS->components_ == NULL)
+    {
+      p2t_sweepcontext_add_hole (THIS->sweep_context_, polyline);
+      return;
+    }
+
+  c = p2t_cdt_find_component (THIS, point_index (polyline, 0));
+  assert (c != NULL);
+  p2t_sweepcontext_add_hole (c->cdt->sweep_context_, polyline);
+  p2t_cdt_component_add_inputs (THIS, c, polyline->len);
 }
 
 void
 p2t_cdt_add_point (P2tCDT *THIS, P2tPoint* point)
 {
-  p2t_sweepcontext_add_point (THIS->sweep_context_, point);
+  P2tCDTComponent* c;
+
+  if (THIS->components_ == NULL)
+    {
+      p2t_sweepcontext_add_point (THIS->sweep_context_, point);
+      return;
+    }
+
+  c = p2t_cdt_find_component (THIS, point);
+  assert (c != NULL);
+  p2t_sweepcontext_add_point (c->cdt->sweep_context_, point);
+  p2t_cdt_component_add_inputs (THIS, c, 1);
+}
+
+void
+p2t_cdt_set_triangle_func (P2tCDT *THIS, P2tTriangleFunc func, gpointer user_data)
+{
+  p2t_sweepcontext_set_triangle_func (THIS->sweep_context_, func, user_data);
+}
+
+/* The state shared by the workers triangulating the components of a CDT */
+typedef struct
+{
+  GPtrArray* components;
+  /* The index of the next component which no worker took yet */
+  volatile gint next;
+} P2tCDTMulti;
+
+static gpointer
+p2t_cdt_multi_worker (gpointer data)
+{
+  P2tCDTMulti* multi = (P2tCDTMulti*) data;
+  gint i;
+
+  while ((i = g_atomic_int_add (&multi->next, 1)) < (gint) multi->components->len)
+    {
+      P2tCDT* cdt = ((P2tCDTComponent*) g_ptr_array_index (multi->components, i))->cdt;
+      p2t_sweep_triangulate (cdt->sweep_, cdt->sweep_context_);
+    }
+  return NULL;
+}
+
+/* Triangulate all the components concurrently. Each one is independent of
+ * the others, so the result doesn't depend on how they were spread over the
+ * threads */
+static void
+p2t_cdt_triangulate_multi (P2tCDT *THIS)
+{
+  P2tSweepContext* tcx = THIS->sweep_context_;
+  P2tTriangleFunc func = tcx->triangle_func_;
+  P2tTrianglePtrArray triangles;
+  P2tCDTMulti multi;
+  GThread** threads;
+  guint n_threads, i;
+
+  multi.components = THIS->components_;
+  multi.next = 0;
+  n_threads = MIN (g_get_num_processors (), THIS->components_->len);
+
+  // The function would be called from several threads at once, so it is
+  // only called once everything is triangulated
+  tcx->triangle_func_ = NULL;
+
+  threads = g_new (GThread*, n_threads);
+  for (i = 1; i < n_threads; i++)
+    threads[i] = g_thread_new ("p2t-cdt-multi", p2t_cdt_multi_worker, &multi);
+
+  p2t_cdt_multi_worker (&multi);
+
+  for (i = 1; i < n_threads; i++)
+    g_thread_join (threads[i]);
+  g_free (threads);
+
+  tcx->triangle_func_ = func;
+  if (func != NULL)
+    {
+      triangles = p2t_cdt_get_triangles (THIS);
+      for (i = 0; i < triangles->len; i++)
+        func (triangle_index (triangles, i), tcx->triangle_func_data_);
+    }
 }
 
 void
 p2t_cdt_triangulate (P2tCDT *THIS)
 {
-  p2t_sweep_triangulate (THIS->sweep_, THIS->sweep_context_);
+  if (THIS->components_ != NULL)
+    p2t_cdt_triangulate_multi (THIS);
+  else
+    p2t_sweep_triangulate (THIS->sweep_, THIS->sweep_context_);
+}
+
+gboolean
+p2t_cdt_insert_point (P2tCDT *THIS, P2tPoint* point)
+{
+  P2tCDTComponent* c;
+  guint n;
+  gboolean result;
+
+  if (THIS->components_ == NULL)
+    return p2t_sweepcontext_insert_point (THIS->sweep_context_, point);
+
+  if ((c = p2t_cdt_find_component (THIS, point)) == NULL)
+    return FALSE;
+
+  n = c->cdt->sweep_context_->input_points_->len;
+  result = p2t_sweepcontext_insert_point (c->cdt->sweep_context_, point);
+  p2t_cdt_component_add_inputs (THIS, c, c->cdt->sweep_context_->input_points_->len - n);
+  return result;
+}
+
+gboolean
+p2t_cdt_insert_edge (P2tCDT *THIS, P2tPoint* p, P2tPoint* q)
+{
+  P2tCDTComponent* c;
+  guint n;
+  gboolean result;
+
+  if (THIS->components_ == NULL)
+    return p2t_sweepcontext_insert_edge (THIS->sweep_context_, p, q);
+
+  if ((c = p2t_cdt_find_component (THIS, p)) == NULL)
+    return FALSE;
+
+  n = c->cdt->sweep_context_->input_points_->len;
+  result = p2t_sweepcontext_insert_edge (c->cdt->sweep_context_, p, q);
+  p2t_cdt_component_add_inputs (THIS, c, c->cdt->sweep_context_->input_points_->len - n);
+  return result;
 }
 
 P2tTrianglePtrArray
 p2t_cdt_get_triangles (P2tCDT *THIS)
 {
-  return p2t_sweepcontext_get_triangles (THIS->sweep_context_);
+  guint i;
+
+  if (THIS->components_ == NULL)
+    return p2t_sweepcontext_get_triangles (THIS->sweep_context_);
+
+  // Gathered on each call, since points and edges may have been inserted
+  // into any of the components since the last one
+  g_ptr_array_set_size (THIS->multi_triangles_, 0);
+  for (i = 0; i < THIS->components_->len; i++)
+    {
+      P2tCDT* cdt = ((P2tCDTComponent*) g_ptr_array_index (THIS->components_, i))->cdt;
+      P2tTrianglePtrArray triangles = p2t_sweepcontext_get_triangles (cdt->sweep_context_);
+      guint start = THIS->multi_triangles_->len;
+
+      g_ptr_array_set_size (THIS->multi_triangles_, start + triangles->len);
+      memcpy (THIS->multi_triangles_->pdata + start, triangles->pdata, triangles->len * sizeof (gpointer));
+    }
+  return THIS->multi_triangles_;
+}
+
+void
+p2t_cdt_get_indices (P2tCDT *THIS, GArray *indices, GArray *neighbors)
+{
+  GArray *part_indices, *part_neighbors = NULL;
+  guint i, j;
+
+  if (THIS->components_ == NULL)
+    {
+      p2t_sweepcontext_get_indices (THIS->sweep_context_, indices, neighbors);
+      return;
+    }
+
+  // Get the indices of each component on its own, and translate them into
+  // the numbering of the whole CDT
+  part_indices = g_array_new (FALSE, FALSE, sizeof (guint32));
+  if (neighbors != NULL)
+    {
+      part_neighbors = g_array_new (FALSE, FALSE, sizeof (guint32));
+      g_array_set_size (neighbors, 0);
+    }
+  g_array_set_size (indices, 0);
+
+  for (i = 0; i < THIS->components_->len; i++)
+    {
+      P2tCDTComponent* c = (P2tCDTComponent*) g_ptr_array_index (THIS->components_, i);
+      guint32 first_triangle = indices->len / 3;
+
+      p2t_sweepcontext_get_indices (c->cdt->sweep_context_, part_indices, part_neighbors);
+      for (j = 0; j < part_indices->len; j++)
+        g_array_index (part_indices, guint32, j) = g_array_index (c->input_index, guint32,
+            g_array_index (part_indices, guint32, j));
+      g_array_append_vals (indices, part_indices->data, part_indices->len);
+
+      if (neighbors == NULL)
+        continue;
+
+      for (j = 0; j < part_neighbors->len; j++)
+        if (g_array_index (part_neighbors, guint32, j) != P2T_CDT_NO_NEIGHBOR)
+          g_array_index (part_neighbors, guint32, j) += first_triangle;
+      g_array_append_vals (neighbors, part_neighbors->data, part_neighbors->len);
+    }
+
+  g_array_free (part_indices, TRUE);
+  if (part_neighbors != NULL)
+    g_array_free (part_neighbors, TRUE);
+}
+
+gboolean
+p2t_cdt_get_stats (P2tCDT *THIS, P2tSweepStats *stats)
+{
+  guint i;
+
+  *stats = THIS->sweep_->stats_;
+
+  // The times of the components are summed up, even though they overlap
+  if (THIS->components_ != NULL)
+    for (i = 1; i < THIS->components_->len; i++)
+      {
+        const P2tSweepStats* s = &((P2tCDTComponent*) g_ptr_array_index (THIS->components_, i))->cdt->sweep_->stats_;
+        stats->point_events += s->point_events;
+        stats->edge_events += s->edge_events;
+        stats->legalized_triangles += s->legalized_triangles;
+        stats->legalize_flips += s->legalize_flips;
+        stats->edge_event_flips += s->edge_event_flips;
+        stats->basin_fills += s->basin_fills;
+        stats->locate_steps += s->locate_steps;
+        stats->edge_walk_steps += s->edge_walk_steps;
+        stats->edge_rotations += s->edge_rotations;
+        stats->sort_time += s->sort_time;
+        stats->sweep_time += s->sweep_time;
+        stats->edge_event_time += s->edge_event_time;
+        stats->finalization_time += s->finalization_time;
+      }
+#ifdef P2T_SWEEP_STATS
+  return TRUE;
+#else
+  return FALSE;
+#endif
+}
+
+void
+p2t_cdt_get_map (P2tCDT *THIS, P2tTriangleMapIter *iter)
+{
+  guint i;
+
+  if (THIS->components_ == NULL)
+    {
+      p2t_sweepcontext_get_map (THIS->sweep_context_, iter);
+      return;
+    }
+
+  // Gathered on each call like the triangles. The empty slots of the maps
+  // are copied along, and skipped by the iterator
+  g_ptr_array_set_size (THIS->multi_map_, 0);
+  for (i = 0; i < THIS->components_->len; i++)
+    {
+      P2tCDT* cdt = ((P2tCDTComponent*) g_ptr_array_index (THIS->components_, i))->cdt;
+      P2tTrianglePtrArray map = cdt->sweep_context_->map_;
+      guint start = THIS->multi_map_->len;
+
+      g_ptr_array_set_size (THIS->multi_map_, start + map->len);
+      memcpy (THIS->multi_map_->pdata + start, map->pdata, map->len * sizeof (gpointer));
+    }
+
+  iter->map = THIS->multi_map_;
+  iter->index = 0;
+}
+
+/* The state shared by all the workers of a batch */
+typedef struct
+{
+  const P2tCDTPolygon* polygons;
+  guint n_polygons;
+  GPtrArray* results;
+  /* The index of the next polygon which no worker took yet */
+  volatile gint next;
+} P2tCDTBatch;
+
+/* Triangulate one polygon of the batch, using (and creating on first use)
+ * the CDT of the worker */
+static void
+p2t_cdt_batch_triangulate_one (const P2tCDTPolygon* polygon, GArray* result, P2tCDT** cdt)
+{
+  int i;
+
+  if (*cdt == NULL)
+    *cdt = p2t_cdt_new_full (polygon->polyline, P2T_CDT_USE_ARENA);
+  else
+    p2t_cdt_reset (*cdt, polygon->polyline);
+
+  if (polygon->holes != NULL)
+    for (i = 0; i < polygon->holes->len; i++)
+      p2t_cdt_add_hole (*cdt, (P2tPointPtrArray) g_ptr_array_index (polygon->holes, i));
+
+  p2t_cdt_triangulate (*cdt);
+  p2t_cdt_get_indices (*cdt, result, NULL);
 }
 
-P2tTrianglePtrList
-p2t_cdt_get_map (P2tCDT *THIS)
+static gpointer
+p2t_cdt_batch_worker (gpointer data)
 {
-  return p2t_sweepcontext_get_map (THIS->sweep_context_);
+  P2tCDTBatch* batch = (P2tCDTBatch*) data;
+  P2tCDT* cdt = NULL;
+  gint i;
+
+  while ((i = g_atomic_int_add (&batch->next, 1)) < (gint) batch->n_polygons)
+    {
+      p2t_cdt_batch_triangulate_one (&batch->polygons[i],
+          (GArray*) g_ptr_array_index (batch->results, i), &cdt);
+    }
+
+  if (cdt != NULL)
+    p2t_cdt_free (cdt);
+  return NULL;
+}
+
+GPtrArray*
+p2t_cdt_triangulate_batch (const P2tCDTPolygon* polygons, guint n_polygons, guint n_threads)
+{
+  P2tCDTBatch batch;
+  GThread** threads;
+  guint i;
+
+  batch.polygons = polygons;
+  batch.n_polygons = n_polygons;
+  batch.next = 0;
+  batch.results = g_ptr_array_new_with_free_func ((GDestroyNotify) g_array_unref);
+  for (i = 0; i < n_polygons; i++)
+    g_ptr_array_add (batch.results, g_array_new (FALSE, FALSE, sizeof (guint32)));
+
+  if (n_threads == 0)
+    n_threads = g_get_num_processors ();
+  n_threads = MIN (n_threads, n_polygons);
+
+  // Polygons are handed out one at a time, so workers which got small
+  // polygons simply take more of them. The calling thread is a worker too
+  threads = g_new (GThread*, n_threads);
+  for (i = 1; i < n_threads; i++)
+    threads[i] = g_thread_new ("p2t-cdt-batch", p2t_cdt_batch_worker, &batch);
+
+  p2t_cdt_batch_worker (&batch);
+
+  for (i = 1; i < n_threads; i++)
+    g_thread_join (threads[i]);
+  g_free (threads);
+
+  return batch.results;
 }
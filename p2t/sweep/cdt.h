@@ -37,6 +37,22 @@
 #include "sweep_context.h"
 #include "sweep.h"
 
+/**
+ * P2tCDTFlags:
+ * @P2T_CDT_DEFAULT: Allocate and free each object of the sweep separately
+ * @P2T_CDT_USE_ARENA: Allocate all the triangles, advancing front nodes and
+ *   edges of the sweep from large contiguous blocks, which are released in one
+ *   shot when the CDT is freed. This saves most of the allocation overhead
+ *   when triangulating many small polygons
+ *
+ * Flags controlling the creation of a #P2tCDT
+ */
+typedef enum
+{
+  P2T_CDT_DEFAULT = 0,
+  P2T_CDT_USE_ARENA = 1 << 0
+} P2tCDTFlags;
+
 /**
  * 
  * @author Mason Green <mason.green@gmail.com>
@@ -53,6 +69,24 @@ struct CDT_
 
   P2tSweepContext* sweep_context_;
   P2tSweep* sweep_;
+  P2tArena* arena_;
+
+  /** The polylines created by #p2t_cdt_new_from_xy over the buffer of the
+   *  caller, or NULL */
+  GPtrArray* xy_polylines_;
+
+  /** The components of a CDT created by #p2t_cdt_new_multi, or NULL */
+  GPtrArray* components_;
+  /** The components bucketed by their bounding boxes, for finding the ones
+   *  which may contain a point */
+  struct P2tCDTGrid_* component_grid_;
+  /** The triangles of all the components, gathered by
+   *  #p2t_cdt_get_triangles */
+  P2tTrianglePtrArray multi_triangles_;
+  /** The triangle maps of all the components, gathered by #p2t_cdt_get_map */
+  P2tTrianglePtrArray multi_map_;
+  /** The amount of points given to a CDT created by #p2t_cdt_new_multi */
+  guint32 n_inputs_;
 
 };
 /**
@@ -64,11 +98,84 @@ void p2t_cdt_init (P2tCDT* THIS, P2tPointPtrArray polyline);
 P2tCDT* p2t_cdt_new (P2tPointPtrArray polyline);
 
 /**
- * Destructor - clean up memory
+ * Constructor - same as #p2t_cdt_new, with flags to control the allocation
+ * strategy of the triangulation
+ *
+ * @param polyline
+ * @param flags
+ */
+void p2t_cdt_init_full (P2tCDT* THIS, P2tPointPtrArray polyline, P2tCDTFlags flags);
+P2tCDT* p2t_cdt_new_full (P2tPointPtrArray polyline, P2tCDTFlags flags);
+
+/**
+ * Constructor - triangulate a polygon (with holes) whose points are stored in
+ * a coordinate buffer owned by the caller. The coordinates are not copied:
+ * the points of the triangulation point directly into the buffer, so it must
+ * stay valid and unchanged for as long as the CDT (and its triangles) is used.
+ *
+ * The outline is made of the points before hole_offsets[0], the i'th hole of
+ * the points from hole_offsets[i] up to the next offset (or up to n_points for
+ * the last hole). As with #p2t_cdt_get_indices, the indices of the points are
+ * their positions in the buffer. More holes and Steiner points may still be
+ * added before triangulating.
+ *
+ * @param xy The coordinates of the points - the x coordinate of each point
+ *        must be directly followed by its y coordinate
+ * @param stride The distance, in doubles, between the x coordinates of two
+ *        consecutive points. 2 for a packed array of (x, y) pairs
+ * @param n_points The amount of points in the buffer
+ * @param hole_offsets The index of the first point of each hole, in
+ *        increasing order, or NULL if there are no holes
+ * @param n_holes The amount of holes
+ * @param flags
+ */
+P2tCDT* p2t_cdt_new_from_xy (const double *xy, gsize stride, gsize n_points,
+                             const gsize *hole_offsets, gsize n_holes,
+                             P2tCDTFlags flags);
+
+/**
+ * Constructor - triangulate several polygons (with holes) at once. The
+ * polylines may be given in any order and orientation: a polyline inside of
+ * an even amount of others is an outline, and one inside of an odd amount is
+ * a hole of the innermost outline around it. Polylines must not cross each
+ * other, but outlines may lie within holes of other outlines.
+ *
+ * Each outline is triangulated on its own, and #p2t_cdt_triangulate spreads
+ * them over one thread per processor. The result is the same as triangulating
+ * each outline separately, in the order of the polylines, whatever the
+ * amount of threads. The triangle function (see #p2t_cdt_set_triangle_func)
+ * is only called once all the outlines are triangulated, from the calling
+ * thread.
+ *
+ * Holes, Steiner points and inserted points or edges go to the innermost
+ * outline containing them (or the first point of them). For
+ * #p2t_cdt_get_indices, the points of the polylines are numbered in the order
+ * they are given, followed by the points added later. #p2t_cdt_reset turns
+ * the CDT back into a CDT of a single polygon
+ *
+ * @param polylines A #GPtrArray of #P2tPointPtrArray, with at least one
+ *        outline
+ * @param flags
+ */
+P2tCDT* p2t_cdt_new_multi (GPtrArray* polylines, P2tCDTFlags flags);
+
+/**
+ * Destructor - clean up memory. Note that if the CDT was created with
+ * #P2T_CDT_USE_ARENA, the triangles it returned are freed as well
  */
 void p2t_cdt_destroy (P2tCDT* THIS);
 void p2t_cdt_free (P2tCDT* THIS);
 
+/**
+ * Reset - prepare the CDT for triangulating a new polyline, as if it was just
+ * created with it. All the triangles of the previous triangulation are freed,
+ * but the memory allocated for the triangulation is kept and reused, so a
+ * stream of polygons can be triangulated with almost no allocations
+ *
+ * @param polyline
+ */
+void p2t_cdt_reset (P2tCDT *THIS, P2tPointPtrArray polyline);
+
 /**
  * Add a hole
  *
@@ -83,19 +190,127 @@ void p2t_cdt_add_hole (P2tCDT *THIS, P2tPointPtrArray polyline);
  */
 void p2t_cdt_add_point (P2tCDT *THIS, P2tPoint* point);
 
+/**
+ * Set a function to receive the interior triangles of the triangulation. It
+ * is called at the end of #p2t_cdt_triangulate, once the sweep is over, by
+ * the pass which finds the triangles inside of the polygon. Each triangle is
+ * passed once, in the order of #p2t_cdt_get_triangles and with its points and
+ * neighbors in their final state, which saves a second pass over them. The
+ * sweep itself can't hand out triangles any earlier, since it only knows
+ * which ones are inside once it is over.
+ * The function is kept across #p2t_cdt_reset, and is not called for the
+ * triangles created by #p2t_cdt_insert_point and #p2t_cdt_insert_edge
+ *
+ * @param func The function, or NULL to stop calling it
+ * @param user_data
+ */
+void p2t_cdt_set_triangle_func (P2tCDT *THIS, P2tTriangleFunc func, gpointer user_data);
+
 /**
  * Triangulate - do this AFTER you've added the polyline, holes, and Steiner points
  */
 void p2t_cdt_triangulate (P2tCDT *THIS);
 
+/**
+ * Insert a point into the triangulation - only valid AFTER triangulating. The
+ * triangles around the point are updated to remain a constrained Delaunay
+ * triangulation, and the rest of the triangulation is left untouched. The
+ * point must stay valid for as long as the CDT is used. As with the Steiner
+ * points, its index for #p2t_cdt_get_indices follows the last point added
+ *
+ * @param point
+ * @return FALSE if the point is outside of the polygon, or if there already
+ *         is a point at the same position - the triangulation is then left
+ *         unchanged
+ */
+gboolean p2t_cdt_insert_point (P2tCDT *THIS, P2tPoint* point);
+
+/**
+ * Insert a constrained edge into the triangulation - only valid AFTER
+ * triangulating. Its ending points are inserted first as with
+ * #p2t_cdt_insert_point, unless there already are points at their positions
+ * which are then used instead. The edge is split at any point of the
+ * triangulation lying on it
+ *
+ * @param p
+ * @param q
+ * @return FALSE if the edge leaves the polygon or crosses another constrained
+ *         edge. The edge is then not inserted, although its ending points may
+ *         have been
+ */
+gboolean p2t_cdt_insert_edge (P2tCDT *THIS, P2tPoint* p, P2tPoint* q);
+
 /**
  * Get CDT triangles
  */
 P2tTrianglePtrArray p2t_cdt_get_triangles (P2tCDT *THIS);
 
 /**
- * Get triangle map
+ * Get CDT triangles as flat index buffers, which refer directly to the order
+ * in which the points were given - first the points of the polyline, and then
+ * the points of the holes and the Steiner points in the order they were added.
+ * Both buffers are resized as needed, so the same arrays may be reused across
+ * triangulations.
+ *
+ * @param indices A #GArray of guint32, which is filled with the indices of
+ *        the three points of each triangle of #p2t_cdt_get_triangles
+ * @param neighbors A #GArray of guint32 or NULL. If given, it is filled with
+ *        three entries per triangle - the index of the neighbor triangle
+ *        across the edge opposite to each point, or #P2T_CDT_NO_NEIGHBOR
+ */
+void p2t_cdt_get_indices (P2tCDT *THIS, GArray *indices, GArray *neighbors);
+
+/**
+ * Get the counters and timings of the last triangulation, see #P2tSweepStats
+ *
+ * @param stats Filled with the statistics, or with zeros if they are not
+ *        collected
+ * @return TRUE if the library was built to collect the statistics
+ */
+gboolean p2t_cdt_get_stats (P2tCDT *THIS, P2tSweepStats *stats);
+
+/**
+ * Get triangle map - initialize an iterator over all the triangles created
+ * by the sweep, including the ones outside of the polygon. Use
+ * #p2t_triangle_map_iter_next to walk over them. For a CDT made by
+ * #p2t_cdt_new_multi, the triangles of all the outlines are walked over, in
+ * the order of the outlines
+ *
+ * @param iter
+ */
+void p2t_cdt_get_map (P2tCDT *THIS, P2tTriangleMapIter *iter);
+
+/**
+ * P2tCDTPolygon:
+ * @polyline: The outline of the polygon, with non repeating points
+ * @holes: An array of #P2tPointPtrArray, one per hole, or NULL
+ *
+ * One polygon of a #p2t_cdt_triangulate_batch call. The triangulation only
+ * reads the points, so polygons of the same batch may share points (such as
+ * the common corners of adjacent polygons), as long as nothing modifies them
+ * until the call returns
+ */
+typedef struct
+{
+  P2tPointPtrArray polyline;
+  GPtrArray* holes;
+} P2tCDTPolygon;
+
+/**
+ * Triangulate many independent polygons at once, spreading them over a set of
+ * worker threads. Each worker reuses one #P2tCDT (see #p2t_cdt_reset) which
+ * allocates from its own arena, so there is almost no per polygon allocation
+ * besides the results.
+ *
+ * The result for each polygon is a #GArray of guint32, holding three point
+ * indices per triangle, as returned by #p2t_cdt_get_indices.
+ *
+ * @param polygons The polygons to triangulate
+ * @param n_polygons The amount of polygons
+ * @param n_threads The amount of threads to use, or 0 to use one per processor
+ * @return A #GPtrArray with the result of each polygon. Freeing it with
+ *         g_ptr_array_free also frees the results
  */
-P2tTrianglePtrList p2t_cdt_get_map (P2tCDT *THIS);
+GPtrArray* p2t_cdt_triangulate_batch (const P2tCDTPolygon* polygons, guint n_polygons, guint n_threads);
 
 #endif
@@ -29,16 +29,38 @@
  * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
  * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
+#include <string.h>
 #include "sweep.h"
 #include "sweep_context.h"
 #include "advancing_front.h"
 #include "../common/utils.h"
 #include "../common/shapes.h"
 
+/* The progress of legalizing one triangle in #p2t_sweep_legalize. Each frame
+ * stands for one level of what used to be a recursive call */
+typedef enum
+{
+  /* Looking for an edge which is not locally Delaunay, starting at i */
+  P2T_SWEEP_LEGALIZE_SCAN,
+  /* Edge i was flipped and t is being legalized */
+  P2T_SWEEP_LEGALIZE_AFTER_T,
+  /* t was legalized, and now ot is being legalized */
+  P2T_SWEEP_LEGALIZE_AFTER_OT
+} P2tSweepLegalizeState;
+
+typedef struct
+{
+  P2tTriangle *t, *ot;
+  int i, oi;
+  P2tSweepLegalizeState state;
+} P2tSweepLegalizeFrame;
+
 void
 p2t_sweep_init (P2tSweep* THIS)
 {
   THIS->nodes_ = g_ptr_array_new ();
+  THIS->legalize_stack_ = g_array_new (FALSE, FALSE, sizeof (P2tSweepLegalizeFrame));
+  memset (&THIS->stats_, 0, sizeof (P2tSweepStats));
 }
 
 P2tSweep*
@@ -63,6 +85,20 @@ p2t_sweep_destroy (P2tSweep* THIS)
     }
 
   g_ptr_array_free (THIS->nodes_, TRUE);
+  g_array_free (THIS->legalize_stack_, TRUE);
+}
+
+void
+p2t_sweep_reset (P2tSweep* THIS)
+{
+  int i;
+  for (i = 0; i < THIS->nodes_->len; i++)
+    {
+      p2t_node_free (node_index (THIS->nodes_, i));
+    }
+
+  g_ptr_array_set_size (THIS->nodes_, 0);
+  g_array_set_size (THIS->legalize_stack_, 0);
 }
 
 void
@@ -77,12 +113,27 @@ p2t_sweep_free (P2tSweep* THIS)
 void
 p2t_sweep_triangulate (P2tSweep *THIS, P2tSweepContext *tcx)
 {
+  gint64 start, end;
+
+  memset (&THIS->stats_, 0, sizeof (P2tSweepStats));
+
+  start = P2T_SWEEP_STAT_TIMESTAMP ();
   p2t_sweepcontext_init_triangulation (tcx);
+  end = P2T_SWEEP_STAT_TIMESTAMP ();
+  P2T_SWEEP_STAT_ADD (THIS, sort_time, end - start);
+
   p2t_sweepcontext_create_advancingfront (tcx, THIS->nodes_);
   // Sweep points; build mesh
+  start = end;
   p2t_sweep_sweep_points (THIS, tcx);
+  end = P2T_SWEEP_STAT_TIMESTAMP ();
+  P2T_SWEEP_STAT_ADD (THIS, sweep_time, end - start - THIS->stats_.edge_event_time);
+  P2T_SWEEP_STAT_ADD (THIS, locate_steps, tcx->front_->locate_steps_);
+
   // Clean up
+  start = end;
   p2t_sweep_finalization_polygon (THIS, tcx);
+  P2T_SWEEP_STAT_ADD (THIS, finalization_time, P2T_SWEEP_STAT_TIMESTAMP () - start);
 }
 
 void
@@ -93,10 +144,20 @@ p2t_sweep_sweep_points (P2tSweep *THIS, P2tSweepContext *tcx)
     {
       P2tPoint* point = p2t_sweepcontext_get_point (tcx, i);
       P2tNode* node = p2t_sweep_point_event (THIS, tcx, point);
-      for (j = 0; j < point->edge_list->len; j++)
+      int edge_count;
+      P2tEdge** edges = p2t_sweepcontext_get_point_edges (tcx, i, &edge_count);
+      gint64 start;
+
+      // Points without edges, such as the Steiner points, have nothing to time
+      if (edge_count == 0)
+        continue;
+
+      start = P2T_SWEEP_STAT_TIMESTAMP ();
+      for (j = 0; j < edge_count; j++)
         {
-          p2t_sweep_edge_event_ed_n (THIS, tcx, edge_index (point->edge_list, j), node);
+          p2t_sweep_edge_event_ed_n (THIS, tcx, edges[j], node);
         }
+      P2T_SWEEP_STAT_ADD (THIS, edge_event_time, P2T_SWEEP_STAT_TIMESTAMP () - start);
     }
 }
 
@@ -121,6 +182,8 @@ p2t_sweep_point_event (P2tSweep *THIS, P2tSweepContext *tcx, P2tPoint* point)
   P2tNode* node = p2t_sweepcontext_locate_node (tcx, point);
   P2tNode* new_node = p2t_sweep_new_front_triangle (THIS, tcx, point, node);
 
+  P2T_SWEEP_STAT_ADD (THIS, point_events, 1);
+
   // Only need to check +epsilon since point never have smaller
   // x value than node due to how we fetch nodes from the front
   if (point->x <= node->point->x + EPSILON)
@@ -137,6 +200,8 @@ p2t_sweep_point_event (P2tSweep *THIS, P2tSweepContext *tcx, P2tPoint* point)
 void
 p2t_sweep_edge_event_ed_n (P2tSweep *THIS, P2tSweepContext *tcx, P2tEdge* edge, P2tNode* node)
 {
+  P2T_SWEEP_STAT_ADD (THIS, edge_events, 1);
+
   tcx->edge_event.constrained_edge = edge;
   tcx->edge_event.right = (edge->p->x > edge->q->x);
 
@@ -204,6 +269,7 @@ p2t_sweep_edge_event_pt_pt_tr_pt (P2tSweep *THIS, P2tSweepContext *tcx, P2tPoint
     {
       // Need to decide if we are rotating CW or CCW to get to a triangle
       // that will cross edge
+      P2T_SWEEP_STAT_ADD (THIS, edge_rotations, 1);
       if (o1 == CW)
         {
           triangle = p2t_triangle_neighbor_ccw (triangle, point);
@@ -242,18 +308,16 @@ p2t_sweep_is_edge_side_of_triangle (P2tSweep *THIS, P2tTriangle *triangle, P2tPo
 P2tNode*
 p2t_sweep_new_front_triangle (P2tSweep *THIS, P2tSweepContext *tcx, P2tPoint* point, P2tNode *node)
 {
-  P2tTriangle* triangle = p2t_triangle_new (point, node->point, node->next->point);
+  P2tTriangle* triangle = p2t_sweepcontext_new_triangle (tcx, point, node->point, node->next->point);
 
   p2t_triangle_mark_neighbor_tr (triangle, node->triangle);
   p2t_sweepcontext_add_to_map (tcx, triangle);
 
-  P2tNode* new_node = p2t_node_new_pt (point);
-  g_ptr_array_add (THIS->nodes_, new_node);
+  P2tNode* new_node = p2t_sweepcontext_new_node (tcx, point, NULL);
+  if (tcx->arena_ == NULL)
+    g_ptr_array_add (THIS->nodes_, new_node);
 
-  new_node->next = node->next;
-  new_node->prev = node;
-  node->next->prev = new_node;
-  node->next = new_node;
+  p2t_advancingfront_insert_after (tcx->front_, node, new_node);
 
   if (!p2t_sweep_legalize (THIS, tcx, triangle))
     {
@@ -266,7 +330,7 @@ p2t_sweep_new_front_triangle (P2tSweep *THIS, P2tSweepContext *tcx, P2tPoint* po
 void
 p2t_sweep_fill (P2tSweep *THIS, P2tSweepContext *tcx, P2tNode* node)
 {
-  P2tTriangle* triangle = p2t_triangle_new (node->prev->point, node->point, node->next->point);
+  P2tTriangle* triangle = p2t_sweepcontext_new_triangle (tcx, node->prev->point, node->point, node->next->point);
 
   // TODO: should copy the constrained_edge value from neighbor triangles
   //       for now constrained_edge values are copied during the legalize
@@ -276,8 +340,7 @@ p2t_sweep_fill (P2tSweep *THIS, P2tSweepContext *tcx, P2tNode* node)
   p2t_sweepcontext_add_to_map (tcx, triangle);
 
   // Update the advancing front
-  node->prev->next = node->next;
-  node->next->prev = node->prev;
+  p2t_sweepcontext_remove_node (tcx, node);
 
   // If it was legalized the triangle has already been mapped
   if (!p2t_sweep_legalize (THIS, tcx, triangle))
@@ -353,106 +416,130 @@ p2t_sweep_hole_angle (P2tSweep *THIS, P2tNode* node)
 gboolean
 p2t_sweep_legalize (P2tSweep *THIS, P2tSweepContext *tcx, P2tTriangle *t)
 {
-  int i;
-  // To legalize a triangle we start by finding if any of the three edges
-  // violate the Delaunay condition
-  for (i = 0; i < 3; i++)
+  // This used to recurse into both triangles of every flipped edge. Instead,
+  // each pending call is a frame on a stack, and the result of the last
+  // frame that finished is passed back through 'legalized'
+  GArray *stack = THIS->legalize_stack_;
+  guint base = stack->len;
+  gboolean legalized = FALSE;
+  P2tSweepLegalizeFrame *f;
+  P2tSweepLegalizeFrame start = { t, NULL, 0, 0, P2T_SWEEP_LEGALIZE_SCAN };
+
+  g_array_append_val (stack, start);
+
+  while (stack->len > base)
     {
-      if (t->delaunay_edge[i])
-        continue;
-
-      P2tTriangle* ot = p2t_triangle_get_neighbor (t, i);
+      f = &g_array_index (stack, P2tSweepLegalizeFrame, stack->len - 1);
+      t = f->t;
 
-      if (ot)
+      if (f->state == P2T_SWEEP_LEGALIZE_AFTER_T)
+        {
+          // Make sure that triangle to node mapping is done only one time for a specific triangle
+          if (!legalized)
+            p2t_sweepcontext_map_triangle_to_nodes (tcx, t);
+
+          P2tSweepLegalizeFrame next = { f->ot, NULL, 0, 0, P2T_SWEEP_LEGALIZE_SCAN };
+          f->state = P2T_SWEEP_LEGALIZE_AFTER_OT;
+          g_array_append_val (stack, next);
+          continue;
+        }
+      else if (f->state == P2T_SWEEP_LEGALIZE_AFTER_OT)
         {
-          P2tPoint* p = p2t_triangle_get_point (t, i);
-          P2tPoint* op = p2t_triangle_opposite_point (ot, t, p);
-          int oi = p2t_triangle_index (ot, op);
+          if (!legalized)
+            p2t_sweepcontext_map_triangle_to_nodes (tcx, f->ot);
+
+          // Reset the Delaunay edges, since they only are valid Delaunay edges
+          // until we add a new triangle or point.
+          // XXX: need to think about this. Can these edges be tried after we
+          //      return to previous recursive level?
+          p2t_triangle_set_delunay_edge_i (t, f->i, FALSE);
+          p2t_triangle_set_delunay_edge_i (f->ot, f->oi, FALSE);
+
+          // If triangle have been legalized no need to check the other edges since
+          // the recursive legalization will handles those so we can end here.
+          legalized = TRUE;
+          g_array_set_size (stack, stack->len - 1);
+          continue;
+        }
 
-          // If this is a Constrained Edge or a Delaunay Edge(only during recursive legalization)
-          // then we should not try to legalize
-          if (ot->constrained_edge[oi] || ot->delaunay_edge[oi])
-            {
-              t->constrained_edge[i] = ot->constrained_edge[oi];
-              continue;
-            }
+      if (f->i == 0)
+        P2T_SWEEP_STAT_ADD (THIS, legalized_triangles, 1);
 
-          gboolean inside = p2t_sweep_incircle (THIS, p, p2t_triangle_point_ccw (t, p), p2t_triangle_point_cw (t, p), op);
+      // To legalize a triangle we start by finding if any of the three edges
+      // violate the Delaunay condition
+      for (; f->i < 3; f->i++)
+        {
+          int i = f->i;
 
-          if (inside)
-            {
-              // Lets mark this shared edge as Delaunay
-              t->delaunay_edge[i] = TRUE;
-              ot->delaunay_edge[oi] = TRUE;
+          if (p2t_triangle_get_delunay_edge_i (t, i))
+            continue;
 
-              // Lets rotate shared edge one vertex CW to legalize it
-              p2t_sweep_rotate_triangle_pair (THIS, t, p, ot, op);
+          P2tTriangle* ot = p2t_triangle_get_neighbor (t, i);
 
-              // We now got one valid Delaunay Edge shared by two triangles
-              // This gives us 4 new edges to check for Delaunay
+          if (ot)
+            {
+              P2tPoint* p = p2t_triangle_get_point (t, i);
+              P2tPoint* op = p2t_triangle_opposite_point (ot, t, p);
+              int oi = p2t_triangle_index (ot, op);
 
-              // Make sure that triangle to node mapping is done only one time for a specific triangle
-              gboolean not_legalized = !p2t_sweep_legalize (THIS, tcx, t);
-              if (not_legalized)
+              // If this is a Constrained Edge or a Delaunay Edge(only during recursive legalization)
+              // then we should not try to legalize
+              if (p2t_triangle_get_constrained_edge_i (ot, oi) || p2t_triangle_get_delunay_edge_i (ot, oi))
                 {
-                  p2t_sweepcontext_map_triangle_to_nodes (tcx, t);
+                  p2t_triangle_set_constrained_edge_i (t, i, p2t_triangle_get_constrained_edge_i (ot, oi));
+                  continue;
                 }
 
-              not_legalized = !p2t_sweep_legalize (THIS, tcx, ot);
-              if (not_legalized)
-                p2t_sweepcontext_map_triangle_to_nodes (tcx, ot);
+              gboolean inside = p2t_sweep_incircle (THIS, p, p2t_triangle_point_ccw (t, p), p2t_triangle_point_cw (t, p), op);
 
-              // Reset the Delaunay edges, since they only are valid Delaunay edges
-              // until we add a new triangle or point.
-              // XXX: need to think about this. Can these edges be tried after we
-              //      return to previous recursive level?
-              t->delaunay_edge[i] = FALSE;
-              ot->delaunay_edge[oi] = FALSE;
-
-              // If triangle have been legalized no need to check the other edges since
-              // the recursive legalization will handles those so we can end here.
-              return TRUE;
+              if (inside)
+                {
+                  // Lets mark this shared edge as Delaunay
+                  p2t_triangle_set_delunay_edge_i (t, i, TRUE);
+                  p2t_triangle_set_delunay_edge_i (ot, oi, TRUE);
+
+                  // Lets rotate shared edge one vertex CW to legalize it
+                  p2t_sweep_rotate_triangle_pair (THIS, t, p, ot, op);
+                  P2T_SWEEP_STAT_ADD (THIS, legalize_flips, 1);
+
+                  // We now got one valid Delaunay Edge shared by two triangles
+                  // This gives us 4 new edges to check for Delaunay
+                  f->ot = ot;
+                  f->oi = oi;
+                  break;
+                }
             }
         }
+
+      if (f->i < 3)
+        {
+          P2tSweepLegalizeFrame next = { t, NULL, 0, 0, P2T_SWEEP_LEGALIZE_SCAN };
+          f->state = P2T_SWEEP_LEGALIZE_AFTER_T;
+          g_array_append_val (stack, next);
+        }
+      else
+        {
+          legalized = FALSE;
+          g_array_set_size (stack, stack->len - 1);
+        }
     }
-  return FALSE;
+
+  return legalized;
 }
 
 gboolean
 p2t_sweep_incircle (P2tSweep *THIS, P2tPoint* pa, P2tPoint* pb, P2tPoint* pc, P2tPoint* pd)
 {
-  double adx = pa->x - pd->x;
-  double ady = pa->y - pd->y;
-  double bdx = pb->x - pd->x;
-  double bdy = pb->y - pd->y;
-
-  double adxbdy = adx * bdy;
-  double bdxady = bdx * ady;
-  double oabd = adxbdy - bdxady;
-
-  if (oabd <= 0)
+  // pd must be inside the angle at pa before it can be inside the circle.
+  // All the tests are exact, so that near-cocircular points can not make
+  // the legalization flip the same edge back and forth
+  if (p2t_utils_orient2d (pa, pb, pd) <= 0)
     return FALSE;
 
-  double cdx = pc->x - pd->x;
-  double cdy = pc->y - pd->y;
-
-  double cdxady = cdx * ady;
-  double adxcdy = adx * cdy;
-  double ocad = cdxady - adxcdy;
-
-  if (ocad <= 0)
+  if (p2t_utils_orient2d (pc, pa, pd) <= 0)
     return FALSE;
 
-  double bdxcdy = bdx * cdy;
-  double cdxbdy = cdx * bdy;
-
-  double alift = adx * adx + ady * ady;
-  double blift = bdx * bdx + bdy * bdy;
-  double clift = cdx * cdx + cdy * cdy;
-
-  double det = alift * (bdxcdy - cdxbdy) + blift * ocad + clift * oabd;
-
-  return det > 0;
+  return p2t_utils_incircle (pa, pb, pc, pd) > 0;
 }
 
 void
@@ -508,6 +595,8 @@ p2t_sweep_rotate_triangle_pair (P2tSweep *THIS, P2tTriangle *t, P2tPoint* p, P2t
 void
 p2t_sweep_fill_basin (P2tSweep *THIS, P2tSweepContext *tcx, P2tNode* node)
 {
+  P2T_SWEEP_STAT_ADD (THIS, basin_fills, 1);
+
   if (p2t_orient2d (node->point, node->next->point, node->next->next->point) == CCW)
     {
       tcx->basin.left_node = node->next->next;
@@ -644,6 +733,7 @@ p2t_sweep_fill_right_above_edge_event (P2tSweep *THIS, P2tSweepContext *tcx, P2t
         }
       else
         {
+          P2T_SWEEP_STAT_ADD (THIS, edge_walk_steps, 1);
           node = node->next;
         }
     }
@@ -730,6 +820,7 @@ p2t_sweep_fill_left_above_edge_event (P2tSweep *THIS, P2tSweepContext *tcx, P2tE
         }
       else
         {
+          P2T_SWEEP_STAT_ADD (THIS, edge_walk_steps, 1);
           node = node->prev;
         }
     }
@@ -822,6 +913,7 @@ p2t_sweep_flip_edge_event (P2tSweep *THIS, P2tSweepContext *tcx, P2tPoint* ep, P
     {
       // Lets rotate shared edge one vertex CW
       p2t_sweep_rotate_triangle_pair (THIS, t, p, ot, op);
+      P2T_SWEEP_STAT_ADD (THIS, edge_event_flips, 1);
       p2t_sweepcontext_map_triangle_to_nodes (tcx, t);
       p2t_sweepcontext_map_triangle_to_nodes (tcx, ot);
 
@@ -861,7 +953,7 @@ p2t_sweep_next_flip_triangle (P2tSweep *THIS, P2tSweepContext *tcx, int o, P2tTr
     {
       // ot is not crossing edge after flip
       int edge_index = p2t_triangle_edge_index (ot, p, op);
-      ot->delaunay_edge[edge_index] = TRUE;
+      p2t_triangle_set_delunay_edge_i (ot, edge_index, TRUE);
       p2t_sweep_legalize (THIS, tcx, ot);
       p2t_triangle_clear_delunay_edges (ot);
       return t;
@@ -870,7 +962,7 @@ p2t_sweep_next_flip_triangle (P2tSweep *THIS, P2tSweepContext *tcx, int o, P2tTr
   // t is not crossing edge after flip
   int edge_index = p2t_triangle_edge_index (t, p, op);
 
-  t->delaunay_edge[edge_index] = TRUE;
+  p2t_triangle_set_delunay_edge_i (t, edge_index, TRUE);
   p2t_sweep_legalize (THIS, tcx, t);
   p2t_triangle_clear_delunay_edges (t);
   return ot;
@@ -42,11 +42,69 @@
 #include "../common/poly2tri-private.h"
 #include "../common/shapes.h"
 
+/**
+ * P2tSweepStats:
+ * @point_events: The amount of points swept
+ * @edge_events: The amount of constrained edges inserted
+ * @legalized_triangles: The amount of triangles checked by the legalization
+ * @legalize_flips: The amount of edges flipped by the legalization
+ * @edge_event_flips: The amount of edges flipped to insert constrained edges
+ * @basin_fills: How many times a basin of the front was filled
+ * @locate_steps: How many node comparisons were made to locate the points on
+ *   the advancing front
+ * @edge_walk_steps: How many nodes above the constrained edges were walked
+ *   over while filling the front below them
+ * @edge_rotations: How many times the edge events turned around a point to
+ *   find the triangle crossed by a constrained edge
+ * @sort_time: The time spent preparing the points (sorting them and grouping
+ *   the edges by point)
+ * @sweep_time: The time spent sweeping the points, not counting the edge
+ *   events
+ * @edge_event_time: The time spent inserting the constrained edges
+ * @finalization_time: The time spent collecting the interior triangles
+ *
+ * Counters and timings of the last triangulation done by a sweep, to catch
+ * the inputs on which it behaves badly. They are only collected when the
+ * library is built with P2T_SWEEP_STATS defined (see --enable-sweep-stats),
+ * and stay zero otherwise. All the times are in microseconds
+ */
+typedef struct
+{
+  guint64 point_events;
+  guint64 edge_events;
+  guint64 legalized_triangles;
+  guint64 legalize_flips;
+  guint64 edge_event_flips;
+  guint64 basin_fills;
+  guint64 locate_steps;
+  guint64 edge_walk_steps;
+  guint64 edge_rotations;
+  gint64 sort_time;
+  gint64 sweep_time;
+  gint64 edge_event_time;
+  gint64 finalization_time;
+} P2tSweepStats;
+
+#ifdef P2T_SWEEP_STATS
+#define P2T_SWEEP_STAT_ADD(sweep, counter, n) ((sweep)->stats_.counter += (n))
+#define P2T_SWEEP_STAT_TIMESTAMP() g_get_monotonic_time ()
+#else
+#define P2T_SWEEP_STAT_ADD(sweep, counter, n) ((void) (n))
+#define P2T_SWEEP_STAT_TIMESTAMP() ((gint64) 0)
+#endif
+
 struct Sweep_
 {
 /* private: */
 P2tNodePtrArray nodes_;
 
+/* The pending legalizations of #p2t_sweep_legalize. Kept between calls so
+ * that the stack is allocated only once per sweep */
+GArray* legalize_stack_;
+
+/* Filled during #p2t_sweep_triangulate when built with P2T_SWEEP_STATS */
+P2tSweepStats stats_;
+
 };
 
 void p2t_sweep_init (P2tSweep* THIS);
@@ -58,6 +116,12 @@ P2tSweep* p2t_sweep_new ();
 void p2t_sweep_destroy (P2tSweep* THIS);
 void p2t_sweep_free (P2tSweep* THIS);
 
+/**
+ * Free the nodes of the previous triangulation, keeping the allocated memory
+ * of the sweep for the next one
+ */
+void p2t_sweep_reset (P2tSweep* THIS);
+
 /**
  * Triangulate
  *
@@ -28,8 +28,11 @@
  * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
  * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
+#include <stdlib.h>
+#include <string.h>
 #include "sweep_context.h"
 #include "advancing_front.h"
+#include "../common/arena.h"
 
 void
 p2t_sweepcontext_basin_init (P2tSweepContextBasin* THIS)
@@ -54,63 +57,144 @@ p2t_sweepcontext_edgeevent_init (P2tSweepContextEdgeEvent* THIS)
   THIS->right = FALSE;
 }
 
-void
-p2t_sweepcontext_init (P2tSweepContext* THIS, P2tPointPtrArray polyline)
+/* Start a new triangulation of the given polyline. All the arrays of the
+ * context must be allocated and empty */
+static void
+p2t_sweepcontext_start (P2tSweepContext* THIS, P2tPointPtrArray polyline)
 {
   int i;
-  THIS->edge_list = g_ptr_array_new ();
-  THIS->triangles_ = g_ptr_array_new ();
-  THIS->map_ = NULL;
+  THIS->map_removed_ = 0;
+  THIS->front_closed_ = FALSE;
 
   p2t_sweepcontext_basin_init (&THIS->basin);
   p2t_sweepcontext_edgeevent_init (&THIS->edge_event);
 
-  THIS->points_ = g_ptr_array_sized_new (polyline->len);
   for (i = 0; i < polyline->len; i++)
     g_ptr_array_add (THIS->points_, point_index (polyline, i));
 
   p2t_sweepcontext_init_edges (THIS, THIS->points_);
 }
 
+/* Free everything that was created for the current triangulation, and empty
+ * the arrays without releasing their memory */
+static void
+p2t_sweepcontext_clear (P2tSweepContext* THIS)
+{
+  int i;
+
+  // These are only created once the triangulation starts
+  if (THIS->head_ != NULL)
+    p2t_point_free (THIS->head_);
+  if (THIS->tail_ != NULL)
+    p2t_point_free (THIS->tail_);
+  if (THIS->front_ != NULL)
+    p2t_advancingfront_free (THIS->front_);
+
+  // Objects allocated from the arena are released along with it
+  if (THIS->arena_ == NULL)
+    {
+      if (THIS->af_head_ != NULL)
+        {
+          p2t_node_free (THIS->af_head_);
+          p2t_node_free (THIS->af_middle_);
+          p2t_node_free (THIS->af_tail_);
+        }
+
+      for (i = 0; i < THIS->map_->len; i++)
+        {
+          P2tTriangle* ptr = triangle_index (THIS->map_, i);
+          if (ptr != NULL)
+            g_free (ptr);
+        }
+
+      for (i = 0; i < THIS->edge_list->len; i++)
+        {
+          p2t_edge_free (edge_index (THIS->edge_list, i));
+        }
+    }
+
+  THIS->head_ = THIS->tail_ = NULL;
+  THIS->front_ = NULL;
+  THIS->af_head_ = THIS->af_middle_ = THIS->af_tail_ = NULL;
+
+  g_ptr_array_set_size (THIS->edge_list, 0);
+  g_ptr_array_set_size (THIS->point_edges_, 0);
+  g_array_set_size (THIS->point_edge_offsets_, 0);
+  g_array_set_size (THIS->edge_points_, 0);
+  g_ptr_array_set_size (THIS->triangles_, 0);
+  g_ptr_array_set_size (THIS->map_, 0);
+  g_ptr_array_set_size (THIS->points_, 0);
+  g_ptr_array_set_size (THIS->input_points_, 0);
+}
+
+void
+p2t_sweepcontext_init (P2tSweepContext* THIS, P2tPointPtrArray polyline, P2tArena* arena)
+{
+  THIS->arena_ = arena;
+  THIS->edge_list = g_ptr_array_new ();
+  THIS->point_edges_ = g_ptr_array_new ();
+  THIS->point_edge_offsets_ = g_array_new (FALSE, FALSE, sizeof (guint32));
+  THIS->edge_points_ = g_array_new (FALSE, FALSE, sizeof (guint32));
+  THIS->triangles_ = g_ptr_array_new ();
+  THIS->map_ = g_ptr_array_new ();
+  THIS->points_ = g_ptr_array_sized_new (polyline->len);
+  THIS->input_points_ = g_ptr_array_new ();
+
+  THIS->head_ = THIS->tail_ = NULL;
+  THIS->front_ = NULL;
+  THIS->af_head_ = THIS->af_middle_ = THIS->af_tail_ = NULL;
+
+  THIS->triangle_func_ = NULL;
+  THIS->triangle_func_data_ = NULL;
+
+  THIS->insert_stack_ = THIS->insert_queue_ = THIS->insert_created_ = NULL;
+  THIS->trace_triangles_ = THIS->trace_crossed_ = NULL;
+  THIS->insert_owners_ = NULL;
+
+  p2t_sweepcontext_start (THIS, polyline);
+}
+
 P2tSweepContext*
-p2t_sweepcontext_new (P2tPointPtrArray polyline)
+p2t_sweepcontext_new (P2tPointPtrArray polyline, P2tArena* arena)
 {
   P2tSweepContext* THIS = g_new (P2tSweepContext, 1);
-  p2t_sweepcontext_init (THIS, polyline);
+  p2t_sweepcontext_init (THIS, polyline, arena);
   return THIS;
 }
 
 void
 p2t_sweepcontext_destroy (P2tSweepContext* THIS)
 {
-  GList* iter;
-  int i;
   // Clean up memory
-
-  p2t_point_free (THIS->head_);
-  p2t_point_free (THIS->tail_);
-  p2t_advancingfront_free (THIS->front_);
-  p2t_node_free (THIS->af_head_);
-  p2t_node_free (THIS->af_middle_);
-  p2t_node_free (THIS->af_tail_);
+  p2t_sweepcontext_clear (THIS);
 
   g_ptr_array_free (THIS->triangles_, TRUE);
+  g_ptr_array_free (THIS->map_, TRUE);
+  g_ptr_array_free (THIS->edge_list, TRUE);
+  g_ptr_array_free (THIS->point_edges_, TRUE);
+  g_array_free (THIS->point_edge_offsets_, TRUE);
+  g_array_free (THIS->edge_points_, TRUE);
+  g_ptr_array_free (THIS->points_, TRUE);
+  g_ptr_array_free (THIS->input_points_, TRUE);
 
-  for (iter = g_list_first (THIS->map_); iter != NULL; iter = g_list_next (iter))
-    {
-      P2tTriangle* ptr = triangle_val (iter);
-      g_free (ptr);
-    }
-
-  g_list_free (THIS->map_);
-
-  for (i = 0; i < THIS->edge_list->len; i++)
+  if (THIS->insert_owners_ != NULL)
     {
-      p2t_edge_free (edge_index (THIS->edge_list, i));
+      g_ptr_array_free (THIS->insert_stack_, TRUE);
+      g_ptr_array_free (THIS->insert_queue_, TRUE);
+      g_ptr_array_free (THIS->insert_created_, TRUE);
+      g_ptr_array_free (THIS->trace_triangles_, TRUE);
+      g_ptr_array_free (THIS->trace_crossed_, TRUE);
+      g_hash_table_destroy (THIS->insert_owners_);
     }
+}
 
-  g_ptr_array_free (THIS->edge_list, TRUE);
-
+void
+p2t_sweepcontext_reset (P2tSweepContext* THIS, P2tPointPtrArray polyline)
+{
+  p2t_sweepcontext_clear (THIS);
+  if (THIS->arena_ != NULL)
+    p2t_arena_clear (THIS->arena_);
+  p2t_sweepcontext_start (THIS, polyline);
 }
 
 void
@@ -124,11 +208,11 @@ void
 p2t_sweepcontext_add_hole (P2tSweepContext *THIS, P2tPointPtrArray polyline)
 {
   int i;
-  p2t_sweepcontext_init_edges (THIS, polyline);
   for (i = 0; i < polyline->len; i++)
     {
       g_ptr_array_add (THIS->points_, point_index (polyline, i));
     }
+  p2t_sweepcontext_init_edges (THIS, polyline);
 }
 
 void
@@ -143,16 +227,161 @@ p2t_sweepcontext_get_triangles (P2tSweepContext *THIS)
   return THIS->triangles_;
 }
 
-P2tTrianglePtrList
-p2t_sweepcontext_get_map (P2tSweepContext *THIS)
+void
+p2t_sweepcontext_get_map (P2tSweepContext *THIS, P2tTriangleMapIter *iter)
+{
+  iter->map = THIS->map_;
+  iter->index = 0;
+}
+
+/* Maps a point to its index in the input order */
+typedef struct
+{
+  P2tPoint* point;
+  guint32 index;
+} P2tSweepContextPointIndex;
+
+static gint
+p2t_sweepcontext_point_index_cmp (gconstpointer a, gconstpointer b)
+{
+  const P2tPoint* pa = ((const P2tSweepContextPointIndex*) a)->point;
+  const P2tPoint* pb = ((const P2tSweepContextPointIndex*) b)->point;
+  return (pa > pb) - (pa < pb);
+}
+
+// Points are looked up by their address in an array sorted by it. Each
+// point is shared by a handful of triangles (or edges), so this is cheap
+// compared to hashing every one of them. The returned array must be freed
+static P2tSweepContextPointIndex*
+p2t_sweepcontext_point_lookup_new (P2tPointPtrArray points)
+{
+  P2tSweepContextPointIndex *lookup = g_new (P2tSweepContextPointIndex, points->len);
+  guint i;
+
+  for (i = 0; i < points->len; i++)
+    {
+      lookup[i].point = point_index (points, i);
+      lookup[i].index = i;
+    }
+  qsort (lookup, points->len, sizeof (P2tSweepContextPointIndex), p2t_sweepcontext_point_index_cmp);
+  return lookup;
+}
+
+static guint32
+p2t_sweepcontext_point_lookup_find (P2tSweepContextPointIndex *lookup, guint n, P2tPoint *point)
+{
+  P2tSweepContextPointIndex key, *found;
+  key.point = point;
+  found = bsearch (&key, lookup, n, sizeof (P2tSweepContextPointIndex), p2t_sweepcontext_point_index_cmp);
+  assert (found != NULL);
+  return found->index;
+}
+
+void
+p2t_sweepcontext_get_indices (P2tSweepContext *THIS, GArray *indices, GArray *neighbors)
+{
+  const guint n = THIS->triangles_->len;
+  P2tSweepContextPointIndex *lookup;
+  guint32 *tri_index = NULL;
+  guint i, j;
+
+  lookup = p2t_sweepcontext_point_lookup_new (THIS->input_points_);
+
+  g_array_set_size (indices, 3 * n);
+  for (i = 0; i < n; i++)
+    for (j = 0; j < 3; j++)
+      g_array_index (indices, guint32, 3 * i + j) = p2t_sweepcontext_point_lookup_find (lookup,
+          THIS->input_points_->len, p2t_triangle_get_point (triangle_index (THIS->triangles_, i), j));
+
+  g_free (lookup);
+
+  if (neighbors == NULL)
+    return;
+
+  // Translate triangles into output indices through their slot in the map.
+  // Triangles outside of the polygon have no output index
+  tri_index = g_new (guint32, THIS->map_->len);
+  for (i = 0; i < THIS->map_->len; i++)
+    tri_index[i] = P2T_CDT_NO_NEIGHBOR;
+  for (i = 0; i < n; i++)
+    tri_index[triangle_index (THIS->triangles_, i)->map_index_] = i;
+
+  g_array_set_size (neighbors, 3 * n);
+  for (i = 0; i < n; i++)
+    for (j = 0; j < 3; j++)
+      {
+        P2tTriangle *neighbor = p2t_triangle_get_neighbor (triangle_index (THIS->triangles_, i), j);
+        g_array_index (neighbors, guint32, 3 * i + j) = (neighbor != NULL) ? tri_index[neighbor->map_index_] : P2T_CDT_NO_NEIGHBOR;
+      }
+
+  g_free (tri_index);
+}
+
+gboolean
+p2t_triangle_map_iter_next (P2tTriangleMapIter *iter, P2tTriangle **triangle)
+{
+  while (iter->index < iter->map->len)
+    {
+      P2tTriangle *t = triangle_index (iter->map, iter->index++);
+      if (t != NULL)
+        {
+          *triangle = t;
+          return TRUE;
+        }
+    }
+  return FALSE;
+}
+
+/* Group the edges by their upper ending point, in the sorted order of the
+ * points (a compressed sparse row layout). Most points have one or two edges,
+ * so this is much denser than keeping an array of edges in every point.
+ * The i'th sorted point is the input point order[i] */
+static void
+p2t_sweepcontext_init_point_edges (P2tSweepContext *THIS, const guint32 *order)
 {
-  return THIS->map_;
+  const guint n = THIS->points_->len;
+  const guint m = THIS->edge_list->len;
+  const guint32 *edge_input = (const guint32*) THIS->edge_points_->data;
+  guint32 *offsets, *edge_point, *rank;
+  guint i;
+
+  g_array_set_size (THIS->point_edge_offsets_, n + 1);
+  offsets = (guint32*) THIS->point_edge_offsets_->data;
+  memset (offsets, 0, (n + 1) * sizeof (guint32));
+
+  rank = g_new (guint32, n);
+  for (i = 0; i < n; i++)
+    rank[order[i]] = i;
+
+  // Count the edges of each point, remembering the point of each edge
+  edge_point = g_new (guint32, m);
+  for (i = 0; i < m; i++)
+    {
+      edge_point[i] = rank[edge_input[i]];
+      offsets[edge_point[i] + 1]++;
+    }
+  g_free (rank);
+
+  for (i = 0; i < n; i++)
+    offsets[i + 1] += offsets[i];
+
+  // Place the edges, keeping the order in which they were added for each
+  // point. The offsets are used as insertion cursors and restored after
+  g_ptr_array_set_size (THIS->point_edges_, m);
+  for (i = 0; i < m; i++)
+    THIS->point_edges_->pdata[offsets[edge_point[i]]++] = edge_index (THIS->edge_list, i);
+  for (i = n; i > 0; i--)
+    offsets[i] = offsets[i - 1];
+  offsets[0] = 0;
+
+  g_free (edge_point);
 }
 
 void
 p2t_sweepcontext_init_triangulation (P2tSweepContext *THIS)
 {
   int i;
+  guint32 *order;
   double xmax = point_index (THIS->points_, 0)->x, xmin = point_index (THIS->points_, 0)->x;
   double ymax = point_index (THIS->points_, 0)->y, ymin = point_index (THIS->points_, 0)->y;
 
@@ -175,8 +404,18 @@ p2t_sweepcontext_init_triangulation (P2tSweepContext *THIS)
   THIS->head_ = p2t_point_new_dd (xmax + dx, ymin - dy);
   THIS->tail_ = p2t_point_new_dd (xmin - dx, ymin - dy);
 
-  // Sort points along y-axis
-  g_ptr_array_sort (THIS->points_, p2t_point_cmp);
+  // Remember the input order for the indexed output
+  g_ptr_array_set_size (THIS->input_points_, THIS->points_->len);
+  memcpy (THIS->input_points_->pdata, THIS->points_->pdata, THIS->points_->len * sizeof (gpointer));
+
+  // Sort points along y-axis, keeping track of where each input point went
+  order = g_new (guint32, THIS->points_->len);
+  p2t_points_sort_order (THIS->input_points_, order);
+  for (i = 0; i < THIS->points_->len; i++)
+    THIS->points_->pdata[i] = THIS->input_points_->pdata[order[i]];
+
+  p2t_sweepcontext_init_point_edges (THIS, order);
+  g_free (order);
 }
 
 void
@@ -184,11 +423,26 @@ p2t_sweepcontext_init_edges (P2tSweepContext *THIS, P2tPointPtrArray polyline)
 {
   int i;
   int num_points = polyline->len;
-  g_ptr_array_set_size (THIS->edge_list, THIS->edge_list->len + num_points); // C-OPTIMIZATION
+  const guint32 base = THIS->points_->len - num_points;
+  // C-OPTIMIZATION: Reserve room for the new edges, growing the array only once
+  g_ptr_array_reserve (THIS->edge_list, num_points);
   for (i = 0; i < num_points; i++)
     {
       int j = i < num_points - 1 ? i + 1 : 0;
-      g_ptr_array_add (THIS->edge_list, p2t_edge_new (point_index (polyline, i), point_index (polyline, j)));
+      guint32 upper;
+      P2tEdge* edge;
+      if (THIS->arena_ != NULL)
+        {
+          edge = p2t_arena_new_struct (THIS->arena_, P2tEdge);
+          p2t_edge_init (edge, point_index (polyline, i), point_index (polyline, j));
+        }
+      else
+        edge = p2t_edge_new (point_index (polyline, i), point_index (polyline, j));
+      g_ptr_array_add (THIS->edge_list, edge);
+
+      // Remember the input index of the upper point, which was swapped into q
+      upper = base + (edge->q == point_index (polyline, j) ? j : i);
+      g_array_append_val (THIS->edge_points_, upper);
     }
 }
 
@@ -198,16 +452,48 @@ p2t_sweepcontext_get_point (P2tSweepContext *THIS, const int index)
   return point_index (THIS->points_, index);
 }
 
+P2tEdge**
+p2t_sweepcontext_get_point_edges (P2tSweepContext *THIS, const int index, int *count)
+{
+  const guint32 *offsets = (const guint32*) THIS->point_edge_offsets_->data;
+  *count = offsets[index + 1] - offsets[index];
+  return (P2tEdge**) THIS->point_edges_->pdata + offsets[index];
+}
+
 void
 p2t_sweepcontext_add_to_map (P2tSweepContext *THIS, P2tTriangle* triangle)
 {
-  THIS->map_ = g_list_append (THIS->map_, triangle);
+  triangle->map_index_ = THIS->map_->len;
+  g_ptr_array_add (THIS->map_, triangle);
+}
+
+P2tTriangle*
+p2t_sweepcontext_new_triangle (P2tSweepContext *THIS, P2tPoint* a, P2tPoint* b, P2tPoint* c)
+{
+  P2tTriangle* triangle;
+  if (THIS->arena_ == NULL)
+    return p2t_triangle_new (a, b, c);
+
+  triangle = p2t_arena_new_struct (THIS->arena_, P2tTriangle);
+  p2t_triangle_init (triangle, a, b, c);
+  return triangle;
+}
+
+P2tNode*
+p2t_sweepcontext_new_node (P2tSweepContext *THIS, P2tPoint* p, P2tTriangle* t)
+{
+  P2tNode* node;
+  if (THIS->arena_ == NULL)
+    return p2t_node_new_pt_tr (p, t);
+
+  node = p2t_arena_new_struct (THIS->arena_, P2tNode);
+  p2t_node_init_pt_tr (node, p, t);
+  return node;
 }
 
 P2tNode*
 p2t_sweepcontext_locate_node (P2tSweepContext *THIS, P2tPoint* point)
 {
-  // TODO implement search tree
   return p2t_advancingfront_locate_node (THIS->front_, point->x);
 }
 
@@ -216,14 +502,13 @@ p2t_sweepcontext_create_advancingfront (P2tSweepContext *THIS, P2tNodePtrArray n
 {
 
   // Initial triangle
-  P2tTriangle* triangle = p2t_triangle_new (point_index (THIS->points_, 0), THIS->tail_, THIS->head_);
+  P2tTriangle* triangle = p2t_sweepcontext_new_triangle (THIS, point_index (THIS->points_, 0), THIS->tail_, THIS->head_);
 
-  THIS->map_ = g_list_append (THIS->map_, triangle);
+  p2t_sweepcontext_add_to_map (THIS, triangle);
 
-  THIS->af_head_ = p2t_node_new_pt_tr (p2t_triangle_get_point (triangle, 1), triangle);
-  THIS->af_middle_ = p2t_node_new_pt_tr (p2t_triangle_get_point (triangle, 0), triangle);
-  THIS->af_tail_ = p2t_node_new_pt (p2t_triangle_get_point (triangle, 2));
-  THIS->front_ = p2t_advancingfront_new (THIS->af_head_, THIS->af_tail_);
+  THIS->af_head_ = p2t_sweepcontext_new_node (THIS, p2t_triangle_get_point (triangle, 1), triangle);
+  THIS->af_middle_ = p2t_sweepcontext_new_node (THIS, p2t_triangle_get_point (triangle, 0), triangle);
+  THIS->af_tail_ = p2t_sweepcontext_new_node (THIS, p2t_triangle_get_point (triangle, 2), NULL);
 
   // TODO: More intuitive if head is middles next and not previous?
   //       so swap head and tail
@@ -231,12 +516,16 @@ p2t_sweepcontext_create_advancingfront (P2tSweepContext *THIS, P2tNodePtrArray n
   THIS->af_middle_->next = THIS->af_tail_;
   THIS->af_middle_->prev = THIS->af_head_;
   THIS->af_tail_->prev = THIS->af_middle_;
+
+  // The front indexes the nodes which are linked to its head
+  THIS->front_ = p2t_advancingfront_new (THIS->af_head_, THIS->af_tail_);
 }
 
 void
 p2t_sweepcontext_remove_node (P2tSweepContext *THIS, P2tNode* node)
 {
-  g_free (node);
+  // The node itself is still owned by the sweep (or the arena)
+  p2t_advancingfront_remove (THIS->front_, node);
 }
 
 void
@@ -257,23 +546,64 @@ p2t_sweepcontext_map_triangle_to_nodes (P2tSweepContext *THIS, P2tTriangle* t)
 void
 p2t_sweepcontext_remove_from_map (P2tSweepContext *THIS, P2tTriangle* triangle)
 {
-  THIS->map_ = g_list_remove (THIS->map_, triangle);
+  int i, j;
+
+  g_ptr_array_index (THIS->map_, triangle->map_index_) = NULL;
+
+  // Once most of the slots are empty, compact the map so that iterating
+  // over it stays proportional to the amount of live triangles
+  if (++THIS->map_removed_ <= THIS->map_->len / 2)
+    return;
+
+  for (i = 0, j = 0; i < THIS->map_->len; i++)
+    {
+      P2tTriangle* t = triangle_index (THIS->map_, i);
+      if (t != NULL)
+        {
+          t->map_index_ = j;
+          g_ptr_array_index (THIS->map_, j++) = t;
+        }
+    }
+  g_ptr_array_set_size (THIS->map_, j);
+  THIS->map_removed_ = 0;
 }
 
 void
 p2t_sweepcontext_mesh_clean (P2tSweepContext *THIS, P2tTriangle* triangle)
 {
   int i;
-  if (triangle != NULL && !p2t_triangle_is_interior (triangle))
+  P2tTrianglePtrArray stack;
+
+  // At most all the live triangles of the map are interior, so reserve room
+  // for them up front instead of growing the array one step at a time
+  g_ptr_array_reserve (THIS->triangles_, THIS->map_->len - THIS->map_removed_);
+
+  // Flood fill with an explicit stack rather than recursion, which could get
+  // as deep as the amount of triangles. Neighbors are pushed in reverse so
+  // that triangles are collected in the same (depth first) order as before
+  stack = g_ptr_array_sized_new (64);
+  g_ptr_array_add (stack, triangle);
+
+  while (stack->len > 0)
     {
+      triangle = triangle_index (stack, stack->len - 1);
+      g_ptr_array_set_size (stack, stack->len - 1);
+
+      if (triangle == NULL || p2t_triangle_is_interior (triangle))
+        continue;
+
       p2t_triangle_is_interior_b (triangle, TRUE);
       g_ptr_array_add (THIS->triangles_, triangle);
-      for (i = 0; i < 3; i++)
+      if (THIS->triangle_func_ != NULL)
+        THIS->triangle_func_ (triangle, THIS->triangle_func_data_);
+      for (i = 2; i >= 0; i--)
         {
-          if (!triangle->constrained_edge[i])
-            p2t_sweepcontext_mesh_clean (THIS, p2t_triangle_get_neighbor (triangle, i));
+          if (!p2t_triangle_get_constrained_edge_i (triangle, i))
+            g_ptr_array_add (stack, p2t_triangle_get_neighbor (triangle, i));
         }
     }
+
+  g_ptr_array_free (stack, TRUE);
 }
 
 P2tAdvancingFront*
@@ -288,6 +618,13 @@ p2t_sweepcontext_point_count (P2tSweepContext *THIS)
   return THIS->points_->len;
 }
 
+void
+p2t_sweepcontext_set_triangle_func (P2tSweepContext *THIS, P2tTriangleFunc func, gpointer user_data)
+{
+  THIS->triangle_func_ = func;
+  THIS->triangle_func_data_ = user_data;
+}
+
 void
 p2t_sweepcontext_set_head (P2tSweepContext *THIS, P2tPoint* p1)
 {
@@ -60,16 +60,58 @@ struct P2tSweepContextEdgeEvent_
 
 void p2t_sweepcontext_edgeevent_init (P2tSweepContextEdgeEvent* THIS);
 
+/**
+ * P2tTriangleMapIter:
+ *
+ * An iterator over all the triangles in the triangle map of a sweep context.
+ * The map is an index-addressed array in which removed triangles leave a
+ * NULL slot behind, so appending and removing triangles are both O(1). The
+ * iterator skips these empty slots. It remains valid as long as no triangles
+ * are removed from the map.
+ */
+struct P2tTriangleMapIter_
+{
+  /*< private >*/
+  P2tTrianglePtrArray map;
+  guint index;
+};
+
+gboolean p2t_triangle_map_iter_next (P2tTriangleMapIter *iter, P2tTriangle **triangle);
+
+/**
+ * P2tTriangleFunc:
+ * @triangle: An interior triangle of the triangulation
+ * @user_data: The data given along with the function
+ *
+ * A function receiving the interior triangles of a triangulation one by one,
+ * as the final pass of the sweep finds that they are inside of the polygon.
+ */
+typedef void (*P2tTriangleFunc) (P2tTriangle *triangle, gpointer user_data);
+
 struct SweepContext_
 {
   P2tEdgePtrArray edge_list;
+  /** The edges grouped by their upper ending point, in the sorted order of
+   *  the points. The edges of the i'th point are the entries of point_edges_
+   *  starting at point_edge_offsets_[i] and ending before
+   *  point_edge_offsets_[i + 1] */
+  P2tEdgePtrArray point_edges_;
+  GArray* point_edge_offsets_;
+  /** The input index of the upper ending point of each edge of edge_list */
+  GArray* edge_points_;
 
   P2tSweepContextBasin basin;
   P2tSweepContextEdgeEvent edge_event;
 
   P2tTrianglePtrArray triangles_;
-  P2tTrianglePtrList map_;
+  /** All the triangles created by the sweep, see #P2tTriangleMapIter */
+  P2tTrianglePtrArray map_;
+  /** Count of the empty slots left in map_ by removed triangles */
+  guint map_removed_;
   P2tPointPtrArray points_;
+  /** The points in the order they were added, before points_ was sorted,
+   *  followed by the points inserted into the finished triangulation */
+  P2tPointPtrArray input_points_;
 
   /** Advancing front */
   P2tAdvancingFront* front_;
@@ -79,16 +121,48 @@ struct SweepContext_
   P2tPoint* tail_;
 
   P2tNode *af_head_, *af_middle_, *af_tail_;
+
+  /** Whether the dents of the advancing front were filled with triangles,
+   *  which makes the area covered by the map convex. Done before the first
+   *  insertion into the finished triangulation */
+  gboolean front_closed_;
+
+  /** Work space of the insertions into the finished triangulation, kept
+   *  from one insertion to the next. NULL until the first one */
+  GPtrArray *insert_stack_, *insert_queue_, *insert_created_;
+  GPtrArray *trace_triangles_, *trace_crossed_;
+  /** A triangle containing each point of the triangles changed by the
+   *  insertion of an edge */
+  GHashTable *insert_owners_;
+
+  /** Called with each interior triangle once it is known, or NULL */
+  P2tTriangleFunc triangle_func_;
+  gpointer triangle_func_data_;
+
+  /** The arena from which triangles, nodes and edges are allocated, or NULL
+   *  if each of them is allocated and freed separately */
+  P2tArena* arena_;
 };
 
-/** Constructor */
-void p2t_sweepcontext_init (P2tSweepContext* THIS, P2tPointPtrArray polyline);
-P2tSweepContext* p2t_sweepcontext_new (P2tPointPtrArray polyline);
+/** Constructor - if arena is not NULL, all the triangles, nodes and edges of
+ *  the sweep will be allocated from it, and it is up to the caller to free
+ *  them by freeing the arena once the context is destroyed */
+void p2t_sweepcontext_init (P2tSweepContext* THIS, P2tPointPtrArray polyline, P2tArena* arena);
+P2tSweepContext* p2t_sweepcontext_new (P2tPointPtrArray polyline, P2tArena* arena);
 
 /** Destructor */
 void p2t_sweepcontext_destroy (P2tSweepContext* THIS);
 void p2t_sweepcontext_delete (P2tSweepContext* THIS);
 
+/** Prepare the context for triangulating a new polyline. Everything that was
+ *  created for the previous triangulation is freed (including everything in
+ *  the arena of the context), but the memory of the arrays is kept */
+void p2t_sweepcontext_reset (P2tSweepContext* THIS, P2tPointPtrArray polyline);
+
+/** Set the function to call with each interior triangle during the final
+ *  stage of the sweep. It is kept when the context is reset */
+void p2t_sweepcontext_set_triangle_func (P2tSweepContext *THIS, P2tTriangleFunc func, gpointer user_data);
+
 void p2t_sweepcontext_set_head (P2tSweepContext *THIS, P2tPoint* p1);
 
 P2tPoint* p2t_sweepcontext_head (P2tSweepContext *THIS);
@@ -110,8 +184,27 @@ void p2t_sweepcontext_map_triangle_to_nodes (P2tSweepContext *THIS, P2tTriangle*
 
 void p2t_sweepcontext_add_to_map (P2tSweepContext *THIS, P2tTriangle* triangle);
 
+/** Allocate a triangle, from the arena of the context if it has one */
+P2tTriangle* p2t_sweepcontext_new_triangle (P2tSweepContext *THIS, P2tPoint* a, P2tPoint* b, P2tPoint* c);
+
+/** Allocate an advancing front node, from the arena of the context if it has
+ *  one. The triangle of the node may be NULL */
+P2tNode* p2t_sweepcontext_new_node (P2tSweepContext *THIS, P2tPoint* p, P2tTriangle* t);
+
 P2tPoint* p2t_sweepcontext_get_point (P2tSweepContext *THIS, const int index);
 
+/** The edges of which the point at the given index is the upper ending point.
+ *  Only valid once the triangulation was initialized */
+P2tEdge** p2t_sweepcontext_get_point_edges (P2tSweepContext *THIS, const int index, int *count);
+
+/** Insert a point into the finished triangulation. Returns FALSE if it is
+ *  outside of the polygon or if there already is a point at its position */
+gboolean p2t_sweepcontext_insert_point (P2tSweepContext *THIS, P2tPoint* point);
+
+/** Insert a constrained edge into the finished triangulation. Returns FALSE
+ *  if it leaves the polygon or crosses a constrained edge */
+gboolean p2t_sweepcontext_insert_edge (P2tSweepContext *THIS, P2tPoint* p, P2tPoint* q);
+
 P2tPoint* SweepContext_GetPoints (P2tSweepContext *THIS);
 
 void p2t_sweepcontext_remove_from_map (P2tSweepContext *THIS, P2tTriangle* triangle);
@@ -125,9 +218,16 @@ P2tAdvancingFront* p2t_sweepcontext_front (P2tSweepContext *THIS);
 void p2t_sweepcontext_mesh_clean (P2tSweepContext *THIS, P2tTriangle* triangle);
 
 P2tTrianglePtrArray p2t_sweepcontext_get_triangles (P2tSweepContext *THIS);
-P2tTrianglePtrList p2t_sweepcontext_get_map (P2tSweepContext *THIS);
+void p2t_sweepcontext_get_map (P2tSweepContext *THIS, P2tTriangleMapIter *iter);
+
+/** The neighbor index of a triangle edge on the boundary of the polygon */
+#define P2T_CDT_NO_NEIGHBOR G_MAXUINT32
+
+/** See #p2t_cdt_get_indices */
+void p2t_sweepcontext_get_indices (P2tSweepContext *THIS, GArray *indices, GArray *neighbors);
 
 void p2t_sweepcontext_init_triangulation (P2tSweepContext *THIS);
+/** The points of @polyline must be the last ones added to the points */
 void p2t_sweepcontext_init_edges (P2tSweepContext *THIS, P2tPointPtrArray polyline);
 
 #endif
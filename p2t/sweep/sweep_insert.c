@@ -0,0 +1,756 @@
+/*
+ * Poly2Tri Copyright (c) 2009-2010, Poly2Tri Contributors
+ * http://code.google.com/p/poly2tri/
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * * Neither the name of Poly2Tri nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* Incremental changes to a triangulation which was already computed by the
+ * sweep - inserting points and constrained edges. Only the triangles around
+ * the change are visited and rewritten. Existing triangles are reused in
+ * place whenever possible, so they keep their slots in the triangle map and
+ * in the list of interior triangles */
+
+#include "sweep_context.h"
+#include "../common/utils.h"
+
+typedef enum
+{
+  P2T_LOCATE_OUTSIDE,
+  P2T_LOCATE_IN_TRIANGLE,
+  P2T_LOCATE_ON_EDGE,
+  P2T_LOCATE_ON_VERTEX
+} P2tLocateResult;
+
+/* What lies on the other side of an edge of a triangle */
+typedef struct
+{
+  P2tTriangle* neighbor;
+  gboolean constrained;
+} P2tEdgeSide;
+
+/* The part of a new constrained edge going from a point up to the first
+ * point of the triangulation on it (end), and the edges it crosses */
+typedef struct
+{
+  P2tPoint* start;
+  P2tPoint* end;
+  /** The triangles crossed by the edge */
+  GPtrArray* triangles;
+  /** The ending points of each crossed edge, two consecutive entries each */
+  GPtrArray* crossed;
+  /** If the edge to end already exists, one of the triangles on it */
+  P2tTriangle* edge_triangle;
+} P2tEdgeTrace;
+
+static P2tEdgeSide
+p2t_edge_side (P2tTriangle* t, int index)
+{
+  P2tEdgeSide side;
+  side.neighbor = p2t_triangle_get_neighbor (t, index);
+  side.constrained = p2t_triangle_get_constrained_edge_i (t, index);
+  return side;
+}
+
+/* A triangle of the triangulation containing the given point, among those
+ * which were rewritten by the current insertion */
+static P2tTriangle*
+p2t_sweepcontext_owner (P2tSweepContext *THIS, P2tPoint* p)
+{
+  return (P2tTriangle*) g_hash_table_lookup (THIS->insert_owners_, p);
+}
+
+static void
+p2t_sweepcontext_own (P2tSweepContext *THIS, P2tTriangle* t)
+{
+  int i;
+  for (i = 0; i < 3; i++)
+    g_hash_table_insert (THIS->insert_owners_, p2t_triangle_get_point (t, i), t);
+}
+
+/* Rewrite a triangle with new points, keeping its slot in the map and its
+ * interior flag. Its neighbors and edge flags are cleared */
+static void
+p2t_sweepcontext_reuse_triangle (P2tTriangle* t, P2tPoint* a, P2tPoint* b, P2tPoint* c)
+{
+  guint map_index = t->map_index_;
+  gboolean interior = p2t_triangle_is_interior (t);
+
+  p2t_triangle_init (t, a, b, c);
+  t->map_index_ = map_index;
+  p2t_triangle_is_interior_b (t, interior);
+}
+
+/* A new triangle on the same side of the polygon boundary as another one */
+static P2tTriangle*
+p2t_sweepcontext_new_triangle_like (P2tSweepContext *THIS, P2tTriangle* like, P2tPoint* a, P2tPoint* b, P2tPoint* c)
+{
+  P2tTriangle* t = p2t_sweepcontext_new_triangle (THIS, a, b, c);
+
+  p2t_sweepcontext_add_to_map (THIS, t);
+  if (p2t_triangle_is_interior (like))
+    {
+      p2t_triangle_is_interior_b (t, TRUE);
+      g_ptr_array_add (THIS->triangles_, t);
+    }
+  return t;
+}
+
+/* Connect the edge p-q of a rewritten triangle to what was on its other side */
+static void
+p2t_sweepcontext_attach (P2tTriangle* t, P2tPoint* p, P2tPoint* q, const P2tEdgeSide* side)
+{
+  if (side->neighbor != NULL)
+    {
+      p2t_triangle_mark_neighbor_pt_pt_tr (t, p, q, side->neighbor);
+      p2t_triangle_mark_neighbor_pt_pt_tr (side->neighbor, p, q, t);
+    }
+  p2t_triangle_set_constrained_edge_i (t, p2t_triangle_edge_index (t, p, q), side->constrained);
+}
+
+static void
+p2t_sweepcontext_link (P2tTriangle* t1, P2tTriangle* t2, P2tPoint* p, P2tPoint* q, gboolean constrained)
+{
+  p2t_triangle_mark_neighbor_pt_pt_tr (t1, p, q, t2);
+  p2t_triangle_mark_neighbor_pt_pt_tr (t2, p, q, t1);
+  p2t_triangle_set_constrained_edge_i (t1, p2t_triangle_edge_index (t1, p, q), constrained);
+  p2t_triangle_set_constrained_edge_i (t2, p2t_triangle_edge_index (t2, p, q), constrained);
+}
+
+/* Where is p relative to t? If it is outside of t, index is set to an edge
+ * which separates them. Otherwise index is the edge (or vertex) on which p
+ * lies. The edges are tested starting from a rotating offset, so that a walk
+ * can't keep circling around the same triangles */
+static P2tLocateResult
+p2t_sweepcontext_classify (P2tTriangle* t, const P2tPoint* p, int start, int *index)
+{
+  double orient[3];
+  int i, k, zeros = 0;
+
+  for (k = 0; k < 3; k++)
+    {
+      i = (start + k) % 3;
+      orient[i] = p2t_utils_orient2d (p2t_triangle_get_point (t, (i + 1) % 3), p2t_triangle_get_point (t, (i + 2) % 3), p);
+      if (orient[i] < 0)
+        {
+          *index = i;
+          return P2T_LOCATE_OUTSIDE;
+        }
+    }
+
+  for (i = 0; i < 3; i++)
+    if (orient[i] == 0)
+      zeros++;
+
+  if (zeros == 0)
+    return P2T_LOCATE_IN_TRIANGLE;
+
+  if (zeros == 1)
+    {
+      for (i = 0; orient[i] != 0; i++);
+      *index = i;
+      return P2T_LOCATE_ON_EDGE;
+    }
+
+  // On two edges - the vertex between them is the one whose edge isn't zero
+  for (i = 0; orient[i] == 0; i++);
+  *index = i;
+  return P2T_LOCATE_ON_VERTEX;
+}
+
+/* Fill the dents of the advancing front with (exterior) triangles, the same
+ * way the sweep fills basins but without legalizing them. The map covers the
+ * area between the bottom edge, from the tail to the head point, and the
+ * front which is monotone along x. Once every point of the front turns
+ * right, that area is convex */
+static void
+p2t_sweepcontext_close_front (P2tSweepContext *THIS)
+{
+  P2tNode* node = p2t_advancingfront_head (THIS->front_)->next;
+
+  while (node->next != NULL)
+    {
+      P2tNode* prev = node->prev;
+      P2tTriangle* triangle;
+
+      if (p2t_utils_orient2d (prev->point, node->point, node->next->point) <= 0)
+        {
+          node = node->next;
+          continue;
+        }
+
+      triangle = p2t_sweepcontext_new_triangle (THIS, prev->point, node->point, node->next->point);
+      p2t_triangle_mark_neighbor_tr (triangle, prev->triangle);
+      p2t_triangle_mark_neighbor_tr (triangle, node->triangle);
+      p2t_sweepcontext_add_to_map (THIS, triangle);
+
+      prev->triangle = triangle;
+      p2t_sweepcontext_remove_node (THIS, node);
+
+      // Removing the point may have made a dent at the previous one
+      node = (prev->prev != NULL) ? prev : prev->next;
+    }
+
+  THIS->front_closed_ = TRUE;
+}
+
+/* Find the triangle (interior or not) containing p, by walking towards it
+ * from the last interior triangle that was created, which is near the last
+ * change. The area covered by the map is made convex first, so the walk can
+ * only leave it if p is outside of it */
+static P2tTriangle*
+p2t_sweepcontext_locate (P2tSweepContext *THIS, const P2tPoint* p, int *index, P2tLocateResult *where)
+{
+  P2tTriangle* t;
+  guint steps;
+
+  *where = P2T_LOCATE_OUTSIDE;
+  if (THIS->triangles_->len == 0)
+    return NULL;
+
+  if (! THIS->front_closed_)
+    p2t_sweepcontext_close_front (THIS);
+
+  t = triangle_index (THIS->triangles_, THIS->triangles_->len - 1);
+  for (steps = 0; t != NULL && steps < THIS->map_->len; steps++)
+    {
+      *where = p2t_sweepcontext_classify (t, p, steps, index);
+      if (*where != P2T_LOCATE_OUTSIDE)
+        return t;
+      t = p2t_triangle_get_neighbor (t, *index);
+    }
+
+  *where = P2T_LOCATE_OUTSIDE;
+  return NULL;
+}
+
+/* Can the edge of t opposite to p be flipped, with o being the point across
+ * it? Only if the quad made of the two triangles is strictly convex */
+static gboolean
+p2t_sweepcontext_can_flip (P2tTriangle* t, P2tPoint* p, P2tPoint* o)
+{
+  P2tPoint *x = p2t_triangle_point_ccw (t, p);
+  P2tPoint *y = p2t_triangle_point_cw (t, p);
+
+  return p2t_utils_orient2d (p, o, x) < 0 && p2t_utils_orient2d (p, o, y) > 0;
+}
+
+/* Replace the edge of t opposite to p by the other diagonal of the quad it
+ * makes with its neighbor ot, whose point across the edge is o. Both
+ * triangles are rewritten in place, t ending up with the edge p-o and the
+ * point before p */
+static void
+p2t_sweepcontext_flip (P2tTriangle* t, P2tPoint* p, P2tTriangle* ot, P2tPoint* o)
+{
+  //      o
+  //    /   \      t: p x y (CCW)
+  //   y --- x     ot: o y x (CCW)
+  //    \   /
+  //      p
+  P2tPoint *x = p2t_triangle_point_ccw (t, p);
+  P2tPoint *y = p2t_triangle_point_cw (t, p);
+  P2tEdgeSide t_x = p2t_edge_side (t, p2t_triangle_index (t, x));
+  P2tEdgeSide t_y = p2t_edge_side (t, p2t_triangle_index (t, y));
+  P2tEdgeSide ot_x = p2t_edge_side (ot, p2t_triangle_index (ot, x));
+  P2tEdgeSide ot_y = p2t_edge_side (ot, p2t_triangle_index (ot, y));
+
+  p2t_sweepcontext_reuse_triangle (t, p, x, o);
+  p2t_sweepcontext_reuse_triangle (ot, p, o, y);
+
+  p2t_sweepcontext_attach (t, p, x, &t_y);
+  p2t_sweepcontext_attach (t, x, o, &ot_y);
+  p2t_sweepcontext_attach (ot, o, y, &ot_x);
+  p2t_sweepcontext_attach (ot, y, p, &t_x);
+  p2t_sweepcontext_link (t, ot, p, o, FALSE);
+}
+
+/* Restore the Delaunay property around p, by flipping the edges opposite to
+ * it in the triangles of the stack as long as the point across them is in
+ * their circumcircle. Constrained edges are never flipped */
+static void
+p2t_sweepcontext_legalize_around (P2tPoint* p, GPtrArray* stack)
+{
+  while (stack->len > 0)
+    {
+      P2tTriangle* t = g_ptr_array_remove_index (stack, stack->len - 1);
+      int i = p2t_triangle_index (t, p);
+      P2tTriangle* ot = p2t_triangle_get_neighbor (t, i);
+      P2tPoint* o;
+
+      if (ot == NULL || p2t_triangle_get_constrained_edge_i (t, i))
+        continue;
+
+      o = p2t_triangle_opposite_point (ot, t, p);
+      if (p2t_utils_incircle (p, p2t_triangle_point_ccw (t, p), p2t_triangle_point_cw (t, p), o) <= 0
+          || ! p2t_sweepcontext_can_flip (t, p, o))
+        continue;
+
+      p2t_sweepcontext_flip (t, p, ot, o);
+      g_ptr_array_add (stack, t);
+      g_ptr_array_add (stack, ot);
+    }
+}
+
+/* Split t into three triangles around p, which lies strictly inside it */
+static void
+p2t_sweepcontext_split_triangle (P2tSweepContext *THIS, P2tTriangle* t, P2tPoint* p, GPtrArray* stack)
+{
+  P2tPoint *a = p2t_triangle_get_point (t, 0);
+  P2tPoint *b = p2t_triangle_get_point (t, 1);
+  P2tPoint *c = p2t_triangle_get_point (t, 2);
+  P2tEdgeSide side_a = p2t_edge_side (t, 0);
+  P2tEdgeSide side_b = p2t_edge_side (t, 1);
+  P2tEdgeSide side_c = p2t_edge_side (t, 2);
+  P2tTriangle *t2, *t3;
+
+  p2t_sweepcontext_reuse_triangle (t, p, b, c);
+  t2 = p2t_sweepcontext_new_triangle_like (THIS, t, p, c, a);
+  t3 = p2t_sweepcontext_new_triangle_like (THIS, t, p, a, b);
+
+  p2t_sweepcontext_attach (t, b, c, &side_a);
+  p2t_sweepcontext_attach (t2, c, a, &side_b);
+  p2t_sweepcontext_attach (t3, a, b, &side_c);
+  p2t_sweepcontext_link (t, t2, p, c, FALSE);
+  p2t_sweepcontext_link (t2, t3, p, a, FALSE);
+  p2t_sweepcontext_link (t3, t, p, b, FALSE);
+
+  g_ptr_array_add (stack, t);
+  g_ptr_array_add (stack, t2);
+  g_ptr_array_add (stack, t3);
+}
+
+/* Split the edge at the given index of t, and the triangle on its other side
+ * if there is one, at p which lies on that edge. Both halves of a constrained
+ * edge remain constrained */
+static void
+p2t_sweepcontext_split_edge (P2tSweepContext *THIS, P2tTriangle* t, int index, P2tPoint* p, GPtrArray* stack)
+{
+  //      a
+  //    /   \        t: a b c (CCW)
+  //   b -p- c       u: d c b (CCW)
+  //    \   /
+  //      d
+  P2tPoint *a = p2t_triangle_get_point (t, index);
+  P2tPoint *b = p2t_triangle_get_point (t, (index + 1) % 3);
+  P2tPoint *c = p2t_triangle_get_point (t, (index + 2) % 3);
+  P2tTriangle *u = p2t_triangle_get_neighbor (t, index);
+  gboolean constrained = p2t_triangle_get_constrained_edge_i (t, index);
+  P2tEdgeSide t_b = p2t_edge_side (t, (index + 1) % 3);
+  P2tEdgeSide t_c = p2t_edge_side (t, (index + 2) % 3);
+  P2tTriangle *t2, *u2;
+
+  p2t_sweepcontext_reuse_triangle (t, a, b, p);
+  t2 = p2t_sweepcontext_new_triangle_like (THIS, t, a, p, c);
+  p2t_sweepcontext_attach (t, a, b, &t_c);
+  p2t_sweepcontext_attach (t2, c, a, &t_b);
+  p2t_sweepcontext_link (t, t2, a, p, FALSE);
+  g_ptr_array_add (stack, t);
+  g_ptr_array_add (stack, t2);
+
+  if (u != NULL)
+    {
+      P2tPoint *d = p2t_triangle_get_point (u, p2t_triangle_edge_index (u, b, c));
+      P2tEdgeSide u_b = p2t_edge_side (u, p2t_triangle_index (u, b));
+      P2tEdgeSide u_c = p2t_edge_side (u, p2t_triangle_index (u, c));
+
+      p2t_sweepcontext_reuse_triangle (u, d, c, p);
+      u2 = p2t_sweepcontext_new_triangle_like (THIS, u, d, p, b);
+      p2t_sweepcontext_attach (u, d, c, &u_b);
+      p2t_sweepcontext_attach (u2, b, d, &u_c);
+      p2t_sweepcontext_link (u, u2, d, p, FALSE);
+
+      p2t_sweepcontext_link (t, u2, b, p, constrained);
+      p2t_sweepcontext_link (t2, u, p, c, constrained);
+      g_ptr_array_add (stack, u);
+      g_ptr_array_add (stack, u2);
+    }
+  else
+    {
+      p2t_triangle_set_constrained_edge_i (t, p2t_triangle_edge_index (t, b, p), constrained);
+      p2t_triangle_set_constrained_edge_i (t2, p2t_triangle_edge_index (t2, p, c), constrained);
+    }
+}
+
+/* Allocate the work space of the insertions on the first one, so that
+ * triangulations which are never changed don't pay for it */
+static void
+p2t_sweepcontext_insert_alloc (P2tSweepContext *THIS)
+{
+  if (THIS->insert_owners_ != NULL)
+    return;
+
+  THIS->insert_stack_ = g_ptr_array_new ();
+  THIS->insert_queue_ = g_ptr_array_new ();
+  THIS->insert_created_ = g_ptr_array_new ();
+  THIS->trace_triangles_ = g_ptr_array_new ();
+  THIS->trace_crossed_ = g_ptr_array_new ();
+  THIS->insert_owners_ = g_hash_table_new (g_direct_hash, g_direct_equal);
+}
+
+/* Make p a point of the triangulation. Returns the point of the
+ * triangulation at the position of p (p itself, unless there already was a
+ * point there), or NULL if p is outside of the polygon */
+static P2tPoint*
+p2t_sweepcontext_insert_vertex (P2tSweepContext *THIS, P2tPoint* p)
+{
+  P2tLocateResult where;
+  int index;
+  P2tTriangle* t = p2t_sweepcontext_locate (THIS, p, &index, &where);
+  GPtrArray* stack;
+
+  p2t_sweepcontext_insert_alloc (THIS);
+  stack = THIS->insert_stack_;
+
+  if (where == P2T_LOCATE_OUTSIDE)
+    return NULL;
+
+  if (where == P2T_LOCATE_ON_VERTEX)
+    return p2t_triangle_get_point (t, index);
+
+  if (! p2t_triangle_is_interior (t))
+    {
+      // A point on the boundary of the polygon may have been found from the
+      // outside of it
+      P2tTriangle* u = (where == P2T_LOCATE_ON_EDGE) ? p2t_triangle_get_neighbor (t, index) : NULL;
+
+      if (u == NULL || ! p2t_triangle_is_interior (u))
+        return NULL;
+
+      index = p2t_triangle_edge_index (u, p2t_triangle_get_point (t, (index + 1) % 3), p2t_triangle_get_point (t, (index + 2) % 3));
+      t = u;
+    }
+
+  if (where == P2T_LOCATE_IN_TRIANGLE)
+    p2t_sweepcontext_split_triangle (THIS, t, p, stack);
+  else
+    p2t_sweepcontext_split_edge (THIS, t, index, p, stack);
+  p2t_sweepcontext_legalize_around (p, stack);
+
+  // The sorted points are only needed by the sweep, which is over
+  g_ptr_array_add (THIS->input_points_, p);
+  return p;
+}
+
+gboolean
+p2t_sweepcontext_insert_point (P2tSweepContext *THIS, P2tPoint* point)
+{
+  return p2t_sweepcontext_insert_vertex (THIS, point) == point;
+}
+
+/* If the edge a-x of t is inside of the polygon, return one of the interior
+ * triangles on it. The triangles around a are visited whether they are
+ * interior or not, so t may be outside of the polygon while its neighbor
+ * across a-x is not, if a-x is a part of the boundary */
+static P2tTriangle*
+p2t_sweepcontext_interior_edge_triangle (P2tTriangle* t, P2tPoint* a, P2tPoint* x)
+{
+  P2tTriangle* u;
+
+  if (p2t_triangle_is_interior (t))
+    return t;
+
+  u = p2t_triangle_get_neighbor (t, p2t_triangle_edge_index (t, a, x));
+  if (u != NULL && p2t_triangle_is_interior (u))
+    return u;
+
+  return NULL;
+}
+
+/* Find the triangles and edges crossed by the edge going from a towards b,
+ * up to the first point of the triangulation on it. Returns FALSE if the
+ * edge leaves the polygon or crosses a constrained edge */
+static gboolean
+p2t_sweepcontext_trace_edge (P2tSweepContext *THIS, P2tPoint* a, P2tPoint* b, P2tEdgeTrace* trace)
+{
+  P2tLocateResult where;
+  int index;
+  P2tTriangle *first, *t, *next;
+  P2tPoint *x = NULL, *y = NULL;
+  gboolean backwards = FALSE;
+  guint steps;
+
+  g_ptr_array_set_size (trace->triangles, 0);
+  g_ptr_array_set_size (trace->crossed, 0);
+  trace->start = a;
+  trace->end = NULL;
+  trace->edge_triangle = NULL;
+
+  first = t = p2t_sweepcontext_locate (THIS, a, &index, &where);
+  assert (where == P2T_LOCATE_ON_VERTEX);
+
+  // Turn around a until finding the triangle in whose corner the edge starts.
+  // If the edge goes along an existing edge, the rest of it starts at the
+  // other end of that edge
+  for (steps = 0; steps < THIS->map_->len; steps++)
+    {
+      double orient_x, orient_y;
+
+      x = p2t_triangle_point_ccw (t, a);
+      y = p2t_triangle_point_cw (t, a);
+      orient_x = p2t_utils_orient2d (a, b, x);
+      orient_y = p2t_utils_orient2d (a, b, y);
+
+      if (x == b || (orient_x == 0 && (x->x - a->x) * (b->x - a->x) + (x->y - a->y) * (b->y - a->y) > 0))
+        {
+          trace->end = x;
+          trace->edge_triangle = p2t_sweepcontext_interior_edge_triangle (t, a, x);
+          return trace->edge_triangle != NULL;
+        }
+      if (y == b || (orient_y == 0 && (y->x - a->x) * (b->x - a->x) + (y->y - a->y) * (b->y - a->y) > 0))
+        {
+          trace->end = y;
+          trace->edge_triangle = p2t_sweepcontext_interior_edge_triangle (t, a, y);
+          return trace->edge_triangle != NULL;
+        }
+      if (orient_x < 0 && orient_y > 0)
+        break;
+
+      next = backwards ? p2t_triangle_get_neighbor (t, p2t_triangle_index (t, x))
+                       : p2t_triangle_get_neighbor (t, p2t_triangle_index (t, y));
+      if (next == NULL && ! backwards)
+        {
+          // Reached the outside of the map, turn the other way around
+          backwards = TRUE;
+          next = p2t_triangle_get_neighbor (first, p2t_triangle_index (first, p2t_triangle_point_ccw (first, a)));
+        }
+      if (next == NULL || next == first)
+        return FALSE;
+      t = next;
+    }
+
+  if (steps == THIS->map_->len || ! p2t_triangle_is_interior (t))
+    return FALSE;
+
+  g_ptr_array_add (trace->triangles, t);
+
+  // Walk along the edge, across the edge x-y which it crosses each time. x is
+  // always on the right of the edge and y on its left
+  for (;;)
+    {
+      int i = p2t_triangle_edge_index (t, x, y);
+      P2tPoint* o;
+      double orient_o;
+
+      next = p2t_triangle_get_neighbor (t, i);
+      if (p2t_triangle_get_constrained_edge_i (t, i) || next == NULL || ! p2t_triangle_is_interior (next))
+        return FALSE;
+
+      g_ptr_array_add (trace->crossed, x);
+      g_ptr_array_add (trace->crossed, y);
+
+      t = next;
+      g_ptr_array_add (trace->triangles, t);
+      o = p2t_triangle_get_point (t, p2t_triangle_edge_index (t, x, y));
+      orient_o = (o == b) ? 0 : p2t_utils_orient2d (a, b, o);
+
+      if (orient_o == 0)
+        {
+          trace->end = o;
+          return TRUE;
+        }
+      if (orient_o > 0)
+        y = o;
+      else
+        x = o;
+    }
+}
+
+/* Find a triangle with the edge p-q, and the point opposite to that edge in
+ * it, by turning around p from the triangle owning it. The edge must exist */
+static P2tTriangle*
+p2t_sweepcontext_find_edge (P2tSweepContext *THIS, P2tPoint* p, P2tPoint* q, P2tPoint** opposite)
+{
+  P2tTriangle *first = p2t_sweepcontext_owner (THIS, p), *t = first;
+  gboolean backwards = FALSE;
+  int index;
+
+  while ((index = p2t_triangle_edge_index (t, p, q)) == -1)
+    {
+      P2tTriangle* next = backwards ? p2t_triangle_neighbor_cw (t, p) : p2t_triangle_neighbor_ccw (t, p);
+      if (next == NULL)
+        {
+          // Reached the outside of the map, turn the other way around
+          assert (! backwards);
+          backwards = TRUE;
+          next = p2t_triangle_neighbor_cw (first, p);
+        }
+      assert (next != first);
+      t = next;
+    }
+
+  *opposite = p2t_triangle_get_point (t, index);
+  return t;
+}
+
+/* Flip as with p2t_sweepcontext_flip, keeping track of the triangles which
+ * now contain the points of the quad */
+static void
+p2t_sweepcontext_flip_owned (P2tSweepContext *THIS, P2tTriangle* t, P2tPoint* p, P2tTriangle* ot, P2tPoint* o)
+{
+  p2t_sweepcontext_flip (t, p, ot, o);
+  p2t_sweepcontext_own (THIS, t);
+  p2t_sweepcontext_own (THIS, ot);
+}
+
+/* Make the traced part of an edge an edge of the triangulation, following
+ * the method of Sloan ("A fast algorithm for generating constrained Delaunay
+ * triangulations", 1993): the crossed edges are flipped until none of them
+ * crosses the new edge anymore, and then the edges created by the flips are
+ * flipped again until they are all Delaunay. All the flips happen between the
+ * crossed triangles, so no triangle is created or destroyed */
+static void
+p2t_sweepcontext_insert_traced_edge (P2tSweepContext *THIS, P2tEdgeTrace* trace)
+{
+  P2tPoint *a = trace->start, *b = trace->end;
+  GPtrArray *queue = THIS->insert_queue_, *created = THIS->insert_created_;
+  guint head = 0, i;
+  gboolean flipped;
+
+  if (trace->edge_triangle != NULL)
+    {
+      // The edge is already there, just constrain it on both sides
+      P2tTriangle* t = trace->edge_triangle;
+      int index = p2t_triangle_edge_index (t, a, b);
+      P2tTriangle* u = p2t_triangle_get_neighbor (t, index);
+
+      p2t_triangle_set_constrained_edge_i (t, index, TRUE);
+      if (u != NULL)
+        p2t_triangle_set_constrained_edge_i (u, p2t_triangle_edge_index (u, a, b), TRUE);
+      return;
+    }
+
+  g_ptr_array_set_size (queue, 0);
+  g_ptr_array_set_size (created, 0);
+  for (i = 0; i < trace->crossed->len; i++)
+    g_ptr_array_add (queue, g_ptr_array_index (trace->crossed, i));
+  for (i = 0; i < trace->triangles->len; i++)
+    p2t_sweepcontext_own (THIS, triangle_index (trace->triangles, i));
+
+  // Among the crossed edges there is always one whose quad is convex, so
+  // cycling through them terminates
+  while (head < queue->len)
+    {
+      P2tPoint *x = point_index (queue, head), *y = point_index (queue, head + 1);
+      P2tPoint *p, *o;
+      P2tTriangle *t = p2t_sweepcontext_find_edge (THIS, x, y, &p);
+      P2tTriangle *ot = p2t_triangle_neighbor_across (t, p);
+
+      head += 2;
+      o = p2t_triangle_opposite_point (ot, t, p);
+      if (! p2t_sweepcontext_can_flip (t, p, o))
+        {
+          g_ptr_array_add (queue, x);
+          g_ptr_array_add (queue, y);
+          continue;
+        }
+
+      p2t_sweepcontext_flip_owned (THIS, t, p, ot, o);
+      if ((p2t_utils_orient2d (a, b, p) > 0 && p2t_utils_orient2d (a, b, o) < 0)
+          || (p2t_utils_orient2d (a, b, p) < 0 && p2t_utils_orient2d (a, b, o) > 0))
+        {
+          g_ptr_array_add (queue, p);
+          g_ptr_array_add (queue, o);
+        }
+      else
+        {
+          g_ptr_array_add (created, p);
+          g_ptr_array_add (created, o);
+        }
+    }
+
+  do
+    {
+      flipped = FALSE;
+      for (i = 0; i < created->len; i += 2)
+        {
+          P2tPoint *x = point_index (created, i), *y = point_index (created, i + 1);
+          P2tPoint *p, *o;
+          P2tTriangle *t, *ot;
+
+          if ((x == a && y == b) || (x == b && y == a))
+            continue;
+
+          t = p2t_sweepcontext_find_edge (THIS, x, y, &p);
+          ot = p2t_triangle_neighbor_across (t, p);
+          o = p2t_triangle_opposite_point (ot, t, p);
+          if (p2t_utils_incircle (p, p2t_triangle_point_ccw (t, p), p2t_triangle_point_cw (t, p), o) <= 0
+              || p2t_triangle_get_constrained_edge_i (t, p2t_triangle_index (t, p))
+              || ! p2t_sweepcontext_can_flip (t, p, o))
+            continue;
+
+          p2t_sweepcontext_flip_owned (THIS, t, p, ot, o);
+          g_ptr_array_index (created, i) = p;
+          g_ptr_array_index (created, i + 1) = o;
+          flipped = TRUE;
+        }
+    }
+  while (flipped);
+
+  {
+    P2tPoint *p;
+    P2tTriangle *t = p2t_sweepcontext_find_edge (THIS, a, b, &p);
+    P2tTriangle *ot = p2t_triangle_neighbor_across (t, p);
+
+    p2t_triangle_set_constrained_edge_i (t, p2t_triangle_edge_index (t, a, b), TRUE);
+    p2t_triangle_set_constrained_edge_i (ot, p2t_triangle_edge_index (ot, a, b), TRUE);
+  }
+
+  g_hash_table_remove_all (THIS->insert_owners_);
+}
+
+gboolean
+p2t_sweepcontext_insert_edge (P2tSweepContext *THIS, P2tPoint* p, P2tPoint* q)
+{
+  P2tEdgeTrace trace;
+  P2tPoint *a, *b, *v;
+  gboolean valid = TRUE;
+
+  if ((a = p2t_sweepcontext_insert_vertex (THIS, p)) == NULL
+      || (b = p2t_sweepcontext_insert_vertex (THIS, q)) == NULL
+      || a == b)
+    return FALSE;
+
+  trace.triangles = THIS->trace_triangles_;
+  trace.crossed = THIS->trace_crossed_;
+
+  // Check the whole edge before changing anything, so that an edge which
+  // can't be inserted leaves the triangulation as it was
+  for (v = a; valid && v != b; v = trace.end)
+    valid = p2t_sweepcontext_trace_edge (THIS, v, b, &trace);
+
+  if (valid)
+    {
+      // The edge is inserted in pieces, each ending at a point which lies on it
+      for (v = a; v != b; v = trace.end)
+        {
+          p2t_sweepcontext_trace_edge (THIS, v, b, &trace);
+          p2t_sweepcontext_insert_traced_edge (THIS, &trace);
+        }
+    }
+
+  return valid;
+}
@@ -8,39 +8,49 @@
 #include "cdt.h"
 #include "visibility.h"
 
-static gboolean  p2tr_cdt_visible_from_tri        (P2trCDT      *self,
-                                                   P2trTriangle *tri,
-                                                   P2trVector2  *p);
+static guint     p2tr_cdt_triangulate_fan         (P2trCDT       *self,
+                                                   P2trPoint     *center,
+                                                   P2trPoint    **edge_pts,
+                                                   guint          n_edge_pts,
+                                                   P2trTriangle **new_tris);
 
-static gboolean  p2tr_cdt_has_empty_circum_circle (P2trCDT      *self,
-                                                   P2trTriangle *tri);
-
-static GList*    p2tr_cdt_triangulate_fan         (P2trCDT   *self,
-                                                   P2trPoint *center,
-                                                   GList     *edge_pts);
-
-static void      p2tr_cdt_flip_fix                (P2trCDT *self,
-                                                   GList   *initial_triangles);
+static void      p2tr_cdt_flip_fix                (P2trCDT       *self,
+                                                   P2trTriangle **initial_triangles,
+                                                   guint          n_initial_triangles);
 
 static gboolean  p2tr_cdt_try_flip                (P2trCDT   *self,
                                                    P2trEdge  *to_flip,
-                                                   GQueue    *new_tris,
+                                                   GPtrArray *new_tris,
                                                    P2trEdge **new_edge);
 
 static void      p2tr_cdt_on_new_point            (P2trCDT   *self,
                                                    P2trPoint *pt);
 
+/* The initial capacity of the work space stacks of the CDT. This is
+ * enough for the insertion of a point in all but very uneven meshes */
+#define P2TR_CDT_STACK_SIZE 64
+
 P2trCDT* p2tr_cdt_new (P2tCDT *cdt)
 {
   P2tTrianglePtrArray cdt_tris = p2t_cdt_get_triangles (cdt);
   GHashTable *point_map = g_hash_table_new (g_direct_hash, g_direct_equal);
   P2trCDT *rmesh = g_slice_new (P2trCDT);
+  P2trVector2 min = { G_MAXDOUBLE, G_MAXDOUBLE }, max = { -G_MAXDOUBLE, -G_MAXDOUBLE };
+  P2trHashSetIter iter;
+  P2trEdge *e;
+  guint n_segments = 0;
 
   gint i, j;
 
   rmesh->mesh = p2tr_mesh_new ();
   rmesh->outline = p2tr_pslg_new ();
 
+  rmesh->tris_to_fix = g_ptr_array_sized_new (P2TR_CDT_STACK_SIZE);
+  rmesh->flipped_edges = g_ptr_array_sized_new (P2TR_CDT_STACK_SIZE);
+  rmesh->cavity = g_ptr_array_sized_new (P2TR_CDT_STACK_SIZE);
+  rmesh->bad_tris = g_ptr_array_sized_new (P2TR_CDT_STACK_SIZE);
+  rmesh->visited = p2tr_hash_set_new_default ();
+
   /* First iteration over the CDT - create all the points */
   for (i = 0; i < cdt_tris->len; i++)
   {
@@ -52,8 +62,14 @@ P2trCDT* p2tr_cdt_new (P2tCDT *cdt)
 
         if (new_pt == NULL)
           {
-            new_pt = p2tr_point_new2 (cdt_pt->x, cdt_pt->y);
+            P2trVector2 c = { cdt_pt->x, cdt_pt->y };
+            new_pt = p2tr_mesh_new_point (rmesh->mesh, &c);
             g_hash_table_insert (point_map, cdt_pt, new_pt);
+
+            min.x = MIN (min.x, cdt_pt->x);
+            min.y = MIN (min.y, cdt_pt->y);
+            max.x = MAX (max.x, cdt_pt->x);
+            max.y = MAX (max.y, cdt_pt->y);
           }
       }
   }
@@ -75,14 +91,17 @@ P2trCDT* p2tr_cdt_new (P2tCDT *cdt)
 
         if (! p2tr_point_has_edge_to (start_new, end_new))
           {
-            gboolean constrained = cdt_tri->constrained_edge[edge_index];
+            gboolean constrained = p2t_triangle_get_constrained_edge_i (cdt_tri, edge_index);
             P2trEdge *edge = p2tr_mesh_new_edge (rmesh->mesh, start_new, end_new, constrained);
 
             /* If the edge is constrained, we should add it to the
              * outline */
             if (constrained)
-              p2tr_pslg_add_new_line(rmesh->outline, &start_new->c,
-                  &end_new->c);
+              {
+                p2tr_pslg_add_new_line(rmesh->outline, &start_new->c,
+                    &end_new->c);
+                n_segments++;
+              }
 
             /* We only wanted to create the edge now. We will use it
              * later */
@@ -109,9 +128,37 @@ P2trCDT* p2tr_cdt_new (P2tCDT *cdt)
     p2tr_triangle_unref (new_tri);
   }
 
+  /* Finally, index the constrained edges (the mesh only holds one of each
+   * edge and its mirror) */
+  rmesh->segments = p2tr_segment_index_new (&min, &max, n_segments);
+  p2tr_hash_set_iter_init (&iter, rmesh->mesh->edges);
+  while (p2tr_hash_set_iter_next (&iter, (gpointer*)&e))
+    if (e->constrained)
+      p2tr_segment_index_add (rmesh->segments, e);
+
   return rmesh;
 }
 
+void
+p2tr_cdt_free (P2trCDT *self)
+{
+  p2tr_segment_index_free (self->segments);
+
+  /* The points of the mesh keep it alive, so clear it before dropping our
+   * reference */
+  p2tr_mesh_clear (self->mesh);
+  p2tr_mesh_unref (self->mesh);
+  p2tr_pslg_free (self->outline);
+
+  g_ptr_array_free (self->tris_to_fix, TRUE);
+  g_ptr_array_free (self->flipped_edges, TRUE);
+  g_ptr_array_free (self->cavity, TRUE);
+  g_ptr_array_free (self->bad_tris, TRUE);
+  p2tr_hash_set_free (self->visited);
+
+  g_slice_free (P2trCDT, self);
+}
+
 void
 p2tr_cdt_validate_edges (P2trCDT *self)
 {
@@ -154,62 +201,36 @@ p2tr_cdt_visible_from_edge (P2trCDT     *self,
   return p2tr_visibility_is_visible_from_edges (self->outline, p, &line, 1);
 }
 
-static gboolean
-p2tr_cdt_visible_from_tri (P2trCDT      *self,
-                           P2trTriangle *tri,
-                           P2trVector2  *p)
-{
-  P2trBoundedLine lines[3];
-  gint i;
-
-  for (i = 0; i < 3; i++)
-    p2tr_bounded_line_init (&lines[i],
-        &P2TR_EDGE_START(tri->edges[i])->c,
-        &tri->edges[i]->end->c);
-
-  return p2tr_visibility_is_visible_from_edges (self->outline, p, lines, 3);
-}
-
-static gboolean
-p2tr_cdt_has_empty_circum_circle (P2trCDT      *self,
-                                  P2trTriangle *tri)
-{
-  P2trCircle circum;
-  P2trPoint *p;
-  P2trHashSetIter iter;
-
-  p2tr_triangle_get_circum_circle (tri, &circum);
-
-  p2tr_hash_set_iter_init (&iter, self->mesh->points);
-  while (p2tr_hash_set_iter_next (&iter, (gpointer*)&p))
-    {
-      /** TODO: FIXME - is a point on a constrained edge really not a
-       * problem?! */
-      if (p2tr_point_has_constrained_edge (p)
-          /* The points of a triangle can't violate its own empty
-           * circumcircle property */
-          || p == tri->edges[0]->end
-          || p == tri->edges[1]->end
-          || p == tri->edges[2]->end)
-          continue;
-
-      if (! p2tr_circle_test_point_outside(&circum, &p->c)
-          && p2tr_cdt_visible_from_tri (self, tri, &p->c))
-          return FALSE;
-    }
-  return TRUE;
-}
-
 void
 p2tr_cdt_validate_cdt (P2trCDT *self)
 {
   P2trHashSetIter iter;
   P2trTriangle *tri;
+  gint i;
 
+  /* A triangulation is a CDT if and only if each edge which isn't
+   * constrained is locally Delaunay - the point across it is not inside
+   * the circumcircle of the triangle. Unlike testing the circumcircle of
+   * each triangle against all the visible points, this only uses the
+   * exact predicates, and doesn't depend on the visibility of points
+   * around the holes of the domain */
   p2tr_hash_set_iter_init (&iter, self->mesh->triangles);
   while (p2tr_hash_set_iter_next (&iter, (gpointer*)&tri))
-    if (! p2tr_cdt_has_empty_circum_circle(self, tri))
-      p2tr_exception_geometric ("Not a CDT!");
+    for (i = 0; i < 3; i++)
+      {
+        P2trEdge *e = tri->edges[i];
+
+        if (e->constrained || e->mirror->tri == NULL)
+          continue;
+
+        /* The points of the triangle in CCW order, see flip_fix */
+        if (p2tr_math_incircle (&P2TR_TRIANGLE_GET_POINT (tri, 0)->c,
+                                &P2TR_TRIANGLE_GET_POINT (tri, 2)->c,
+                                &P2TR_TRIANGLE_GET_POINT (tri, 1)->c,
+                                &p2tr_triangle_get_opposite_point (e->mirror->tri, e->mirror)->c)
+            == P2TR_INCIRCLE_IN)
+          p2tr_exception_geometric ("Not a CDT!");
+      }
 }
 
 P2trPoint*
@@ -217,10 +238,12 @@ p2tr_cdt_insert_point (P2trCDT           *self,
                        const P2trVector2 *pc,
                        P2trTriangle      *point_location_guess)
 {
-  P2trTriangle *tri;
-  P2trPoint    *pt;
-  gboolean      inserted = FALSE;
-  gint          i;
+  P2trTriangle   *tri;
+  P2trPoint      *pt;
+  gboolean        inserted = FALSE;
+  gint            i;
+  gdouble         ax[3], ay[3], bx[3], by[3], cx[3], cy[3];
+  P2trOrientation orient[3];
 
   if (point_location_guess == NULL)
     tri = p2tr_mesh_find_point (self->mesh, pc);
@@ -236,8 +259,20 @@ p2tr_cdt_insert_point (P2trCDT           *self,
   for (i = 0; i < 3; i++)
     {
       P2trEdge *edge = tri->edges[i];
-      if (p2tr_math_orient2d (& P2TR_EDGE_START(edge)->c,
-              &edge->end->c, pc) == P2TR_ORIENTATION_LINEAR)
+      ax[i] = P2TR_EDGE_START(edge)->c.x;
+      ay[i] = P2TR_EDGE_START(edge)->c.y;
+      bx[i] = edge->end->c.x;
+      by[i] = edge->end->c.y;
+      cx[i] = pc->x;
+      cy[i] = pc->y;
+    }
+
+  p2tr_math_orient2d_batch (ax, ay, bx, by, cx, cy, orient, 3);
+
+  for (i = 0; i < 3; i++)
+    {
+      P2trEdge *edge = tri->edges[i];
+      if (orient[i] == P2TR_ORIENTATION_LINEAR)
         {
           p2tr_cdt_split_edge (self, edge, pt);
           inserted = TRUE;
@@ -254,6 +289,135 @@ p2tr_cdt_insert_point (P2trCDT           *self,
   return pt;
 }
 
+/* The resolution of the grid over which the Hilbert curve for ordering
+ * the points of p2tr_cdt_insert_points is laid, in bits per axis */
+#define P2TR_CDT_HILBERT_BITS 16
+
+typedef struct
+{
+  /* The BRIO round in the high half, the Hilbert index in the low half */
+  guint64 key;
+  guint   index;
+} P2trCDTInsertItem;
+
+static gint
+p2tr_cdt_insert_item_cmp (gconstpointer a,
+                          gconstpointer b,
+                          gpointer      user_data)
+{
+  guint64 ka = ((const P2trCDTInsertItem*) a)->key;
+  guint64 kb = ((const P2trCDTInsertItem*) b)->key;
+  return (ka > kb) - (ka < kb);
+}
+
+/* The distance along a Hilbert curve filling a square of 2^BITS by
+ * 2^BITS cells, of the cell (x,y) */
+static guint32
+p2tr_cdt_hilbert_index (guint32 x,
+                        guint32 y)
+{
+  const guint32 n = 1 << P2TR_CDT_HILBERT_BITS;
+  guint32 s, d = 0;
+
+  for (s = n / 2; s > 0; s /= 2)
+    {
+      guint32 rx = (x & s) > 0;
+      guint32 ry = (y & s) > 0;
+      d += s * s * ((3 * rx) ^ ry);
+
+      /* Rotate the quadrant so the curve inside it is in the standard
+       * orientation */
+      if (ry == 0)
+        {
+          guint32 t;
+          if (rx == 1)
+            {
+              x = n - 1 - x;
+              y = n - 1 - y;
+            }
+          t = x;
+          x = y;
+          y = t;
+        }
+    }
+
+  return d;
+}
+
+void
+p2tr_cdt_insert_points (P2trCDT           *self,
+                        const P2trVector2 *points,
+                        guint              n_points,
+                        P2trPoint        **result)
+{
+  P2trCDTInsertItem *items;
+  P2trVector2 min = { G_MAXDOUBLE, G_MAXDOUBLE }, max = { -G_MAXDOUBLE, -G_MAXDOUBLE };
+  gdouble scale;
+  guint32 seed = 0x9E3779B9;
+  guint i, max_level = 0;
+  P2trTriangle *guess = NULL;
+
+  if (n_points == 0)
+    return;
+
+  for (i = 0; i < n_points; i++)
+    {
+      min.x = MIN (min.x, points[i].x);
+      min.y = MIN (min.y, points[i].y);
+      max.x = MAX (max.x, points[i].x);
+      max.y = MAX (max.y, points[i].y);
+    }
+
+  scale = MAX (max.x - min.x, max.y - min.y);
+  scale = (scale > 0) ? ((1 << P2TR_CDT_HILBERT_BITS) - 1) / scale : 0;
+
+  while ((1u << max_level) < n_points)
+    max_level++;
+
+  /* Each point goes into the last round with a probability of 1/2, into
+   * the one before it with a probability of 1/4 and so on. Within each
+   * round, the points are sorted along the Hilbert curve */
+  items = g_new (P2trCDTInsertItem, n_points);
+  for (i = 0; i < n_points; i++)
+    {
+      guint level = 0;
+      guint32 hx = (guint32) ((points[i].x - min.x) * scale);
+      guint32 hy = (guint32) ((points[i].y - min.y) * scale);
+
+      seed ^= seed << 13;
+      seed ^= seed >> 17;
+      seed ^= seed << 5;
+
+      while (level < max_level && (seed & (1u << level)))
+        level++;
+
+      items[i].key = ((guint64) (max_level - level) << 32) | p2tr_cdt_hilbert_index (hx, hy);
+      items[i].index = i;
+    }
+
+  g_qsort_with_data (items, n_points, sizeof (P2trCDTInsertItem),
+      p2tr_cdt_insert_item_cmp, NULL);
+
+  for (i = 0; i < n_points; i++)
+    {
+      P2trPoint *pt = p2tr_cdt_insert_point (self, &points[items[i].index], guess);
+      GList *iter;
+
+      /* The next point is most likely close to this one */
+      guess = NULL;
+      foreach (iter, pt->outgoing_edges)
+        if ((guess = ((P2trEdge*) iter->data)->tri) != NULL)
+          break;
+
+      if (result != NULL)
+        result[items[i].index] = pt;
+      else
+        p2tr_point_unref (pt);
+    }
+
+  g_free (items);
+}
+
 /** Insert a point into a triangle. This function assumes the point is
  * inside the triangle - not on one of its edges and not outside of it.
  */
@@ -262,15 +426,15 @@ p2tr_cdt_insert_point_into_triangle (P2trCDT      *self,
                                      P2trPoint    *P,
                                      P2trTriangle *tri)
 {
-  GList *new_tris;
+  P2trTriangle *new_tris[3];
 
   P2trPoint *A = tri->edges[0]->end;
   P2trPoint *B = tri->edges[1]->end;
   P2trPoint *C = tri->edges[2]->end;
 
-  P2trEdge *CA = tri->edges[1];
-  P2trEdge *AB = tri->edges[2];
-  P2trEdge *BC = tri->edges[0];
+  P2trEdge *CA = tri->edges[0];
+  P2trEdge *AB = tri->edges[1];
+  P2trEdge *BC = tri->edges[2];
 
   P2trEdge *AP, *BP, *CP;
 
@@ -280,10 +444,9 @@ p2tr_cdt_insert_point_into_triangle (P2trCDT      *self,
   BP = p2tr_mesh_new_edge (self->mesh, B, P, FALSE);
   CP = p2tr_mesh_new_edge (self->mesh, C, P, FALSE);
 
-  new_tris = p2tr_utils_new_reversed_pointer_list (3,
-      p2tr_mesh_new_triangle (self->mesh, AB, BP, AP->mirror),
-      p2tr_mesh_new_triangle (self->mesh, BC, CP, BP->mirror),
-      p2tr_mesh_new_triangle (self->mesh, CA, AP, CP->mirror));
+  new_tris[0] = p2tr_mesh_new_triangle (self->mesh, AB, BP, AP->mirror);
+  new_tris[1] = p2tr_mesh_new_triangle (self->mesh, BC, CP, BP->mirror);
+  new_tris[2] = p2tr_mesh_new_triangle (self->mesh, CA, AP, CP->mirror);
 
   p2tr_edge_unref (CP);
   p2tr_edge_unref (BP);
@@ -292,38 +455,38 @@ p2tr_cdt_insert_point_into_triangle (P2trCDT      *self,
   /* Flip fix the newly created triangles to preserve the the
    * constrained delaunay property. The flip-fix function will unref the
    * new triangles for us! */
-  p2tr_cdt_flip_fix (self, new_tris);
-
-  g_list_free (new_tris);
+  p2tr_cdt_flip_fix (self, new_tris, 3);
 }
 
 /**
  * Triangulate a polygon by creating edges to a center point.
  * 1. If there is a NULL point in the polygon, two triangles are not
  *    created (these are the two that would have used it)
- * 2. THE RETURNED TRIANGLES MUST BE UNREFFED!
+ * 2. The new triangles are stored in @ref new_tris, which must have room
+ *    for @ref n_edge_pts triangles, and their amount is returned
+ * 3. THE RETURNED TRIANGLES MUST BE UNREFFED!
  */
-static GList*
-p2tr_cdt_triangulate_fan (P2trCDT   *self,
-                          P2trPoint *center,
-                          GList     *edge_pts)
+static guint
+p2tr_cdt_triangulate_fan (P2trCDT       *self,
+                          P2trPoint     *center,
+                          P2trPoint    **edge_pts,
+                          guint          n_edge_pts,
+                          P2trTriangle **new_tris)
 {
-  GList *new_tris = NULL;
-  GList *iter;
+  guint i, n_tris = 0;
 
   /* We can not triangulate unless at least two points are given */
-  if (edge_pts == NULL || edge_pts->next == NULL)
+  if (n_edge_pts < 2)
     {
       p2tr_exception_programmatic ("Not enough points to triangulate as"
           " a star!");
     }
 
-  for (iter = edge_pts; iter != NULL; iter = iter->next)
+  for (i = 0; i < n_edge_pts; i++)
     {
-      P2trPoint *A = (P2trPoint*) iter->data;
-      P2trPoint *B = (P2trPoint*) g_list_cyclic_next (edge_pts, iter)->data;
+      P2trPoint *A = edge_pts[i];
+      P2trPoint *B = edge_pts[(i + 1) % n_edge_pts];
       P2trEdge *AB, *BC, *CA;
-      P2trTriangle *tri;
 
       if (A == NULL || B == NULL)
         continue;
@@ -332,14 +495,13 @@ p2tr_cdt_triangulate_fan (P2trCDT   *self,
       BC = p2tr_mesh_new_or_existing_edge (self->mesh, B, center, FALSE);
       CA = p2tr_mesh_new_or_existing_edge (self->mesh, center, A, FALSE);
 
-      tri = p2tr_mesh_new_triangle (self->mesh, AB, BC, CA);
-      new_tris = g_list_prepend (new_tris, tri);
+      new_tris[n_tris++] = p2tr_mesh_new_triangle (self->mesh, AB, BC, CA);
 
       p2tr_edge_unref (BC);
       p2tr_edge_unref (CA);
     }
 
-  return new_tris;
+  return n_tris;
 }
 
 /**
@@ -370,23 +532,30 @@ p2tr_cdt_split_edge (P2trCDT   *self,
   P2trPoint *W = (e->mirror->tri != NULL) ? p2tr_triangle_get_opposite_point (e->mirror->tri, e->mirror) : NULL;
   gboolean   constrained = e->constrained;
   P2trEdge  *XC, *CY;
-  GList     *new_tris = NULL, *fan = NULL, *new_edges = NULL;
+  P2trPoint *fan[4];
+  P2trTriangle *new_tris[4];
+  guint      n_tris;
+  GList     *new_edges = NULL;
+
+  if (constrained)
+    p2tr_segment_index_remove (self->segments, e);
 
   p2tr_edge_remove (e);
 
   XC = p2tr_mesh_new_edge (self->mesh, X, C, constrained);
   CY = p2tr_mesh_new_edge (self->mesh, C, Y, constrained);
 
-  fan = p2tr_utils_new_reversed_pointer_list (4, W, X, V, Y);
-  new_tris = p2tr_cdt_triangulate_fan (self, C, fan);
-  g_list_free (fan);
+  fan[0] = Y;
+  fan[1] = V;
+  fan[2] = X;
+  fan[3] = W;
+  n_tris = p2tr_cdt_triangulate_fan (self, C, fan, 4, new_tris);
 
   /* Now make this a CDT again
    * The new triangles will be unreffed by the flip_fix function, which
    * is good since we receive them with an extra reference!
    */
-  p2tr_cdt_flip_fix (self, new_tris);
-  g_list_free (new_tris);
+  p2tr_cdt_flip_fix (self, new_tris, n_tris);
 
   if (constrained)
     {
@@ -396,6 +565,8 @@ p2tr_cdt_split_edge (P2trCDT   *self,
         p2tr_exception_geometric ("Subsegments gone!");
       else
         {
+          p2tr_segment_index_add (self->segments, XC);
+          p2tr_segment_index_add (self->segments, CY);
           new_edges = g_list_prepend (new_edges, CY);
           new_edges = g_list_prepend (new_edges, XC);
         }
@@ -435,25 +606,31 @@ p2tr_cdt_split_edge (P2trCDT   *self,
 /**
  * THE GIVEN INPUT TRIANGLES MUST BE GIVEN WITH AN EXTRA REFERENCE SINCE
  * THEY WILL BE UNREFFED!
+ * The triangles waiting to be fixed and the flipped edges are kept on the
+ * work space stacks of the CDT, so the order in which the triangles are
+ * fixed does not matter - every flip only creates new triangles to check.
  */
 static void
-p2tr_cdt_flip_fix (P2trCDT *self,
-                   GList   *initial_triangles)
+p2tr_cdt_flip_fix (P2trCDT       *self,
+                   P2trTriangle **initial_triangles,
+                   guint          n_initial_triangles)
 {
-  GQueue flipped_edges, tris_to_fix;
-  GList *iter;
+  GPtrArray *tris_to_fix = self->tris_to_fix;
+  GPtrArray *flipped_edges = self->flipped_edges;
+  guint      j;
 
-  g_queue_init (&flipped_edges);
-  g_queue_init (&tris_to_fix);
+  for (j = 0; j < n_initial_triangles; j++)
+    g_ptr_array_add (tris_to_fix, initial_triangles[j]);
 
-  for (iter = initial_triangles; iter != NULL; iter = iter->next)
-    g_queue_push_tail (&tris_to_fix, iter->data);
-
-  while (! g_queue_is_empty (&tris_to_fix))
+  while (tris_to_fix->len > 0)
     {
-      P2trTriangle *tri = (P2trTriangle*)g_queue_pop_head (&tris_to_fix);
-      P2trCircle   circum_circle;
-      gint         i;
+      P2trTriangle *tri = (P2trTriangle*) g_ptr_array_index (tris_to_fix, tris_to_fix->len - 1);
+      P2trEdge     *candidates[3];
+      gdouble       ax[3], ay[3], bx[3], by[3], cx[3], cy[3], dx[3], dy[3];
+      P2trInCircle  incircle[3];
+      gint          i, n = 0;
+
+      g_ptr_array_set_size (tris_to_fix, tris_to_fix->len - 1);
 
       if (p2tr_triangle_is_removed (tri))
         {
@@ -461,8 +638,10 @@ p2tr_cdt_flip_fix (P2trCDT *self,
           continue;
         }
 
-      p2tr_triangle_get_circum_circle (tri, &circum_circle);
-
+      /* Collect the opposite points of all the edges which may be
+       * flipped, and test them against the circumcircle together. The
+       * points of the triangle are passed in CCW order so that being
+       * inside the circle gives a positive determinant */
       for (i = 0; i < 3; i++)
         {
           P2trEdge  *e = tri->edges[i];
@@ -472,12 +651,32 @@ p2tr_cdt_flip_fix (P2trCDT *self,
               continue;
 
           opposite = p2tr_triangle_get_opposite_point (e->mirror->tri, e->mirror);
-          if (! p2tr_circle_test_point_outside(&circum_circle, &opposite->c))
+
+          ax[n] = P2TR_TRIANGLE_GET_POINT (tri, 0)->c.x;
+          ay[n] = P2TR_TRIANGLE_GET_POINT (tri, 0)->c.y;
+          bx[n] = P2TR_TRIANGLE_GET_POINT (tri, 2)->c.x;
+          by[n] = P2TR_TRIANGLE_GET_POINT (tri, 2)->c.y;
+          cx[n] = P2TR_TRIANGLE_GET_POINT (tri, 1)->c.x;
+          cy[n] = P2TR_TRIANGLE_GET_POINT (tri, 1)->c.y;
+          dx[n] = opposite->c.x;
+          dy[n] = opposite->c.y;
+          candidates[n++] = e;
+        }
+
+      p2tr_math_incircle_batch (ax, ay, bx, by, cx, cy, dx, dy, incircle, n);
+
+      for (i = 0; i < n; i++)
+        {
+          P2trEdge *e = candidates[i];
+
+          /* Cocircular points are already Delaunay either way, and
+           * flipping them would only flip the new edge back again */
+          if (incircle[i] == P2TR_INCIRCLE_IN)
             {
               P2trEdge *flipped;
-              if (p2tr_cdt_try_flip (self, e, &tris_to_fix, &flipped))
+              if (p2tr_cdt_try_flip (self, e, tris_to_fix, &flipped))
                 {
-                  g_queue_push_tail (&flipped_edges, flipped);
+                  g_ptr_array_add (flipped_edges, flipped);
                   /* Stop iterating this triangle since it doesn't exist
                    * any more */
                   break;
@@ -489,12 +688,14 @@ p2tr_cdt_flip_fix (P2trCDT *self,
       p2tr_triangle_unref (tri);
     }
 
-  while (! g_queue_is_empty (&flipped_edges))
+  for (j = 0; j < flipped_edges->len; j++)
     {
-      P2trEdge *e = (P2trEdge*) g_queue_pop_head (&flipped_edges);
+      P2trEdge *e = (P2trEdge*) g_ptr_array_index (flipped_edges, j);
       e->delaunay = e->mirror->delaunay = FALSE;
       p2tr_edge_unref (e);
     }
+
+  g_ptr_array_set_size (flipped_edges, 0);
 }
 
 /**
@@ -507,7 +708,7 @@ p2tr_cdt_flip_fix (P2trCDT *self,
 static gboolean
 p2tr_cdt_try_flip (P2trCDT   *self,
                    P2trEdge  *to_flip,
-                   GQueue    *new_tris,
+                   GPtrArray *new_tris,
                    P2trEdge **new_edge)
 {
   /*    C
@@ -520,7 +721,7 @@ p2tr_cdt_try_flip (P2trCDT   *self,
   P2trTriangle *ABC, *ADB;
   P2trEdge *DC;
 
-  new_edge = NULL;
+  *new_edge = NULL;
 
   if (to_flip->constrained || to_flip->delaunay)
     {
@@ -547,12 +748,12 @@ p2tr_cdt_try_flip (P2trCDT   *self,
   DC = p2tr_mesh_new_edge (self->mesh, D, C, FALSE);
   DC->delaunay = DC->mirror->delaunay = TRUE;
 
-  g_queue_push_tail (new_tris, p2tr_mesh_new_triangle (self->mesh,
+  g_ptr_array_add (new_tris, p2tr_mesh_new_triangle (self->mesh,
       p2tr_point_get_edge_to (C, A),
       p2tr_point_get_edge_to (A, D),
       DC));
 
-  g_queue_push_tail (new_tris, p2tr_mesh_new_triangle (self->mesh,
+  g_ptr_array_add (new_tris, p2tr_mesh_new_triangle (self->mesh,
       p2tr_point_get_edge_to (D, B),
       p2tr_point_get_edge_to (B, C),
       DC->mirror));
@@ -572,22 +773,76 @@ static void
 p2tr_cdt_on_new_point (P2trCDT   *self,
                        P2trPoint *pt)
 {
-  GList *bad_tris = NULL;
-  P2trTriangle *tri;
-  P2trHashSetIter iter;
+  GPtrArray   *bad_tris = self->bad_tris;
+  GPtrArray   *cavity = self->cavity;
+  P2trHashSet *visited = self->visited;
+  GList       *iter;
+
+  /* Only the triangles around the new point may have stopped being
+   * Delaunay, so there is no need to look at the whole mesh. Start from
+   * the triangles of the point, and grow the cavity across the edges
+   * which may be flipped into the neighbors whose circumcircle contains
+   * the point. A triangle beyond a constrained edge or outside of the
+   * cavity keeps both its points and its neighbors, so it can't be made
+   * non-Delaunay by the new point */
+  foreach (iter, pt->outgoing_edges)
+    {
+      P2trTriangle *tri = ((P2trEdge*) iter->data)->tri;
 
-  p2tr_hash_set_iter_init (&iter, self->mesh->triangles);
-  while (p2tr_hash_set_iter_next (&iter, (gpointer*)&tri))
+      if (tri == NULL || p2tr_hash_set_contains (visited, tri))
+        continue;
+
+      p2tr_hash_set_insert (visited, tri);
+      g_ptr_array_add (cavity, tri);
+    }
+
+  while (cavity->len > 0)
     {
-      if (p2tr_triangle_circumcircle_contains_point (tri, &pt->c)
-          != P2TR_INCIRCLE_OUT)
+      P2trTriangle *tri = (P2trTriangle*) g_ptr_array_index (cavity, cavity->len - 1);
+      P2trTriangle *candidates[3];
+      gdouble       ax[3], ay[3], bx[3], by[3], cx[3], cy[3], dx[3], dy[3];
+      P2trInCircle  incircle[3];
+      gint          i, n = 0;
+
+      g_ptr_array_set_size (cavity, cavity->len - 1);
+
+      g_ptr_array_add (bad_tris, tri);
+      p2tr_triangle_ref (tri);
+
+      /* Test all the neighbors of the triangle together. As in
+       * p2tr_cdt_flip_fix, their points are passed in CCW order */
+      for (i = 0; i < 3; i++)
         {
-          bad_tris = g_list_prepend (bad_tris, tri);
-          p2tr_triangle_ref (tri);
+          P2trEdge     *e = tri->edges[i];
+          P2trTriangle *neighbor = e->mirror->tri;
+
+          if (e->constrained || neighbor == NULL
+              || p2tr_hash_set_contains (visited, neighbor))
+            continue;
+
+          p2tr_hash_set_insert (visited, neighbor);
+
+          ax[n] = P2TR_TRIANGLE_GET_POINT (neighbor, 0)->c.x;
+          ay[n] = P2TR_TRIANGLE_GET_POINT (neighbor, 0)->c.y;
+          bx[n] = P2TR_TRIANGLE_GET_POINT (neighbor, 2)->c.x;
+          by[n] = P2TR_TRIANGLE_GET_POINT (neighbor, 2)->c.y;
+          cx[n] = P2TR_TRIANGLE_GET_POINT (neighbor, 1)->c.x;
+          cy[n] = P2TR_TRIANGLE_GET_POINT (neighbor, 1)->c.y;
+          dx[n] = pt->c.x;
+          dy[n] = pt->c.y;
+          candidates[n++] = neighbor;
         }
+
+      p2tr_math_incircle_batch (ax, ay, bx, by, cx, cy, dx, dy, incircle, n);
+
+      for (i = 0; i < n; i++)
+        if (incircle[i] != P2TR_INCIRCLE_OUT)
+          g_ptr_array_add (cavity, candidates[i]);
     }
 
-  p2tr_cdt_flip_fix (self, bad_tris);
-  g_list_free (bad_tris);
+  p2tr_hash_set_remove_all (visited);
+
+  p2tr_cdt_flip_fix (self, (P2trTriangle**) bad_tris->pdata, bad_tris->len);
+  g_ptr_array_set_size (bad_tris, 0);
 }
 
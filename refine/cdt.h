@@ -4,27 +4,70 @@
 #include <p2t/poly2tri.h>
 #include "mesh.h"
 #include "pslg.h"
+#include "segment-index.h"
 
 typedef struct
 {
   P2trMesh *mesh;
   P2trPSLG *outline;
+  /* The constrained edges of the mesh, kept up to date as they are split */
+  P2trSegmentIndex *segments;
+  /* Work space for restoring the CDT after an insertion. The stacks are
+   * emptied but never shrunk, so once they grew to the size of a typical
+   * insertion, restoring the CDT does not allocate any memory */
+  GPtrArray        *tris_to_fix;
+  GPtrArray        *flipped_edges;
+  GPtrArray        *cavity;
+  GPtrArray        *bad_tris;
+  P2trHashSet      *visited;
 } P2trCDT;
 
 P2trCDT*    p2tr_cdt_new (P2tCDT *cdt);
 
+/**
+ * Free a CDT along with its mesh, its outline, its index of segments and
+ * its work space. Points, edges and triangles of the mesh which are still
+ * referenced elsewhere are removed from the mesh, but stay valid until
+ * they are unreffed
+ */
+void        p2tr_cdt_free (P2trCDT *self);
+
 gboolean    p2tr_cdt_visible_from_edge (P2trCDT     *self,
                                         P2trEdge    *e,
                                         P2trVector2 *p);
 
 void        p2tr_cdt_validate_edges    (P2trCDT *self);
 
+/**
+ * Check that the mesh is a constrained Delaunay triangulation, by checking
+ * that every edge which isn't constrained is locally Delaunay. Raises a
+ * geometric exception otherwise
+ */
 void        p2tr_cdt_validate_cdt            (P2trCDT *self);
 
 P2trPoint*  p2tr_cdt_insert_point (P2trCDT           *self,
                                    const P2trVector2 *pc,
                                    P2trTriangle      *point_location_guess);
 
+/**
+ * Insert many points at once. The points are inserted in a biased
+ * randomized insertion order (BRIO) - in rounds of doubling size, each
+ * round sorted along a Hilbert curve - and each point is located starting
+ * from the triangles of the point inserted before it. Locating the points
+ * and restoring the CDT after each of them then only takes a few steps.
+ * @param[in] self The CDT to insert the points into
+ * @param[in] points The points to insert, which must all be inside of
+ *            the triangulation domain
+ * @param[in] n_points The amount of points
+ * @param[out] result NULL, or an array of n_points which is filled with
+ *             the new points in the order of the given points. THE
+ *             RETURNED POINTS MUST BE UNREFFED!
+ */
+void        p2tr_cdt_insert_points (P2trCDT           *self,
+                                    const P2trVector2 *points,
+                                    guint              n_points,
+                                    P2trPoint        **result);
+
 void        p2tr_cdt_insert_point_into_triangle (P2trCDT      *self,
                                                  P2trPoint    *pt,
                                                  P2trTriangle *tri);
@@ -54,17 +54,20 @@ p2tr_cdt_get_segments_encroached_by (P2trCDT     *self,
   P2trHashSet *encroached_edges = p2tr_hash_set_new (g_direct_hash,
       g_direct_equal, (GDestroyNotify) p2tr_edge_unref);
 
-  P2trHashSetIter iter;
-  P2trEdge *e;
-  
-  p2tr_hash_set_iter_init (&iter, self->mesh->edges);
-  while (p2tr_hash_set_iter_next (&iter, (gpointer*)&e))
-    if (e->constrained
-        && p2tr_hash_set_contains (encroached_edges, e->mirror) == FALSE
-        && p2tr_cdt_is_encroached_by (self, e, C))
-      {
-        p2tr_hash_set_insert (encroached_edges, e);
-      }
+  /* Only the segments listed in the cell of the point may have it inside
+   * their diametral circle. Each segment is listed once per cell */
+  GPtrArray *candidates = p2tr_segment_index_query (self->segments, C);
+  guint i;
+
+  for (i = 0; i < candidates->len; i++)
+    {
+      P2trEdge *e = (P2trEdge*) g_ptr_array_index (candidates, i);
+      if (p2tr_cdt_is_encroached_by (self, e, C))
+        {
+          p2tr_hash_set_insert (encroached_edges, e);
+          p2tr_edge_ref (e);
+        }
+    }
 
   return encroached_edges;
 }
@@ -66,15 +66,12 @@ p2tr_edge_is_removed (P2trEdge *self)
 static void
 p2tr_edge_remove_one_side (P2trEdge *self)
 {
+  /* Removing the triangle also drops the reference of this edge to it,
+   * and clears the triangle of this edge */
   if (self->tri != NULL)
-  {
     p2tr_triangle_remove (self->tri);
-    p2tr_triangle_unref (self->tri);
-    self->tri = NULL;
-  }
   _p2tr_point_remove_edge(P2TR_EDGE_START(self), self);
   p2tr_point_unref (self->end);
-  self->end = NULL;
 }
 
 void
@@ -86,14 +83,14 @@ p2tr_edge_remove (P2trEdge *self)
     return;
 
   mesh = p2tr_edge_get_mesh (self);
+  /* The start point of each side is the end point of the other side, so
+   * both are only cleared once both sides are removed */
   p2tr_edge_remove_one_side (self);
   p2tr_edge_remove_one_side (self->mirror);
+  self->end = self->mirror->end = NULL;
   
   if (mesh != NULL)
-  {
     p2tr_mesh_on_edge_removed (mesh, self);
-    p2tr_mesh_on_edge_removed (mesh, self->mirror);
-  }
 }
 
 void
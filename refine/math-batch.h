@@ -0,0 +1,146 @@
+/* The SIMD kernels of the batch predicates. This file is included by
+ * math.c once for each instruction set, after defining:
+ * - P2trMathVec, the vector type, and P2TR_MATH_LANES, its width
+ * - p2tr_math_vec_load/store/add/sub/mul/abs, the vector operations
+ * - P2TR_MATH_KERNEL (name), which adds the instruction set to a name
+ * - P2TR_MATH_TARGET, the attributes needed for the instruction set
+ *
+ * Each kernel evaluates whole blocks of two vectors of instances, and
+ * returns how many instances it evaluated. The determinants are computed
+ * with the same operations as the scalar code in math.c, and classified
+ * by it.
+ */
+
+static inline P2TR_MATH_TARGET void
+P2TR_MATH_KERNEL (p2tr_math_orient2d_det_vec) (const gdouble *ax, const gdouble *ay,
+                                               const gdouble *bx, const gdouble *by,
+                                               const gdouble *cx, const gdouble *cy,
+                                               gdouble       *det,
+                                               gdouble       *detsum)
+{
+  P2trMathVec vcx = p2tr_math_vec_load (cx);
+  P2trMathVec vcy = p2tr_math_vec_load (cy);
+  P2trMathVec acx = p2tr_math_vec_sub (p2tr_math_vec_load (ax), vcx);
+  P2trMathVec acy = p2tr_math_vec_sub (p2tr_math_vec_load (ay), vcy);
+  P2trMathVec bcx = p2tr_math_vec_sub (p2tr_math_vec_load (bx), vcx);
+  P2trMathVec bcy = p2tr_math_vec_sub (p2tr_math_vec_load (by), vcy);
+
+  P2trMathVec detleft = p2tr_math_vec_mul (acx, bcy);
+  P2trMathVec detright = p2tr_math_vec_mul (acy, bcx);
+
+  p2tr_math_vec_store (det, p2tr_math_vec_sub (detleft, detright));
+  p2tr_math_vec_store (detsum, p2tr_math_vec_add (p2tr_math_vec_abs (detleft),
+                                                  p2tr_math_vec_abs (detright)));
+}
+
+static inline P2TR_MATH_TARGET void
+P2TR_MATH_KERNEL (p2tr_math_incircle_det_vec) (const gdouble *ax, const gdouble *ay,
+                                               const gdouble *bx, const gdouble *by,
+                                               const gdouble *cx, const gdouble *cy,
+                                               const gdouble *dx, const gdouble *dy,
+                                               gdouble       *det,
+                                               gdouble       *permanent)
+{
+  P2trMathVec vdx = p2tr_math_vec_load (dx);
+  P2trMathVec vdy = p2tr_math_vec_load (dy);
+  P2trMathVec adx = p2tr_math_vec_sub (p2tr_math_vec_load (ax), vdx);
+  P2trMathVec ady = p2tr_math_vec_sub (p2tr_math_vec_load (ay), vdy);
+  P2trMathVec bdx = p2tr_math_vec_sub (p2tr_math_vec_load (bx), vdx);
+  P2trMathVec bdy = p2tr_math_vec_sub (p2tr_math_vec_load (by), vdy);
+  P2trMathVec cdx = p2tr_math_vec_sub (p2tr_math_vec_load (cx), vdx);
+  P2trMathVec cdy = p2tr_math_vec_sub (p2tr_math_vec_load (cy), vdy);
+
+  P2trMathVec bdxcdy = p2tr_math_vec_mul (bdx, cdy);
+  P2trMathVec cdxbdy = p2tr_math_vec_mul (cdx, bdy);
+  P2trMathVec cdxady = p2tr_math_vec_mul (cdx, ady);
+  P2trMathVec adxcdy = p2tr_math_vec_mul (adx, cdy);
+  P2trMathVec adxbdy = p2tr_math_vec_mul (adx, bdy);
+  P2trMathVec bdxady = p2tr_math_vec_mul (bdx, ady);
+
+  P2trMathVec alift = p2tr_math_vec_add (p2tr_math_vec_mul (adx, adx),
+                                         p2tr_math_vec_mul (ady, ady));
+  P2trMathVec blift = p2tr_math_vec_add (p2tr_math_vec_mul (bdx, bdx),
+                                         p2tr_math_vec_mul (bdy, bdy));
+  P2trMathVec clift = p2tr_math_vec_add (p2tr_math_vec_mul (cdx, cdx),
+                                         p2tr_math_vec_mul (cdy, cdy));
+
+  P2trMathVec ta = p2tr_math_vec_mul (alift, p2tr_math_vec_sub (bdxcdy, cdxbdy));
+  P2trMathVec tb = p2tr_math_vec_mul (blift, p2tr_math_vec_sub (cdxady, adxcdy));
+  P2trMathVec tc = p2tr_math_vec_mul (clift, p2tr_math_vec_sub (adxbdy, bdxady));
+
+  P2trMathVec pa = p2tr_math_vec_mul (alift, p2tr_math_vec_add (
+      p2tr_math_vec_abs (bdxcdy), p2tr_math_vec_abs (cdxbdy)));
+  P2trMathVec pb = p2tr_math_vec_mul (blift, p2tr_math_vec_add (
+      p2tr_math_vec_abs (cdxady), p2tr_math_vec_abs (adxcdy)));
+  P2trMathVec pc = p2tr_math_vec_mul (clift, p2tr_math_vec_add (
+      p2tr_math_vec_abs (adxbdy), p2tr_math_vec_abs (bdxady)));
+
+  p2tr_math_vec_store (det, p2tr_math_vec_add (p2tr_math_vec_add (ta, tb), tc));
+  p2tr_math_vec_store (permanent, p2tr_math_vec_add (p2tr_math_vec_add (pa, pb), pc));
+}
+
+static P2TR_MATH_TARGET guint
+P2TR_MATH_KERNEL (p2tr_math_orient2d_blocks) (const gdouble   *ax,
+                                              const gdouble   *ay,
+                                              const gdouble   *bx,
+                                              const gdouble   *by,
+                                              const gdouble   *cx,
+                                              const gdouble   *cy,
+                                              P2trOrientation *result,
+                                              guint            n)
+{
+  gdouble det[2 * P2TR_MATH_LANES], detsum[2 * P2TR_MATH_LANES];
+  guint   i, j;
+
+  for (i = 0; i + 2 * P2TR_MATH_LANES <= n; i += 2 * P2TR_MATH_LANES)
+    {
+      for (j = 0; j < 2 * P2TR_MATH_LANES; j += P2TR_MATH_LANES)
+        P2TR_MATH_KERNEL (p2tr_math_orient2d_det_vec) (ax + i + j, ay + i + j,
+                                                       bx + i + j, by + i + j,
+                                                       cx + i + j, cy + i + j,
+                                                       det + j, detsum + j);
+
+      for (j = 0; j < 2 * P2TR_MATH_LANES; j++)
+        result[i + j] = p2tr_math_orient2d_classify (det[j], detsum[j],
+                                                     ax[i + j], ay[i + j],
+                                                     bx[i + j], by[i + j],
+                                                     cx[i + j], cy[i + j]);
+    }
+
+  return i;
+}
+
+static P2TR_MATH_TARGET guint
+P2TR_MATH_KERNEL (p2tr_math_incircle_blocks) (const gdouble *ax,
+                                              const gdouble *ay,
+                                              const gdouble *bx,
+                                              const gdouble *by,
+                                              const gdouble *cx,
+                                              const gdouble *cy,
+                                              const gdouble *dx,
+                                              const gdouble *dy,
+                                              P2trInCircle  *result,
+                                              guint          n)
+{
+  gdouble det[2 * P2TR_MATH_LANES], permanent[2 * P2TR_MATH_LANES];
+  guint   i, j;
+
+  for (i = 0; i + 2 * P2TR_MATH_LANES <= n; i += 2 * P2TR_MATH_LANES)
+    {
+      for (j = 0; j < 2 * P2TR_MATH_LANES; j += P2TR_MATH_LANES)
+        P2TR_MATH_KERNEL (p2tr_math_incircle_det_vec) (ax + i + j, ay + i + j,
+                                                       bx + i + j, by + i + j,
+                                                       cx + i + j, cy + i + j,
+                                                       dx + i + j, dy + i + j,
+                                                       det + j, permanent + j);
+
+      for (j = 0; j < 2 * P2TR_MATH_LANES; j++)
+        result[i + j] = p2tr_math_incircle_classify (det[j], permanent[j],
+                                                     ax[i + j], ay[i + j],
+                                                     bx[i + j], by[i + j],
+                                                     cx[i + j], cy[i + j],
+                                                     dx[i + j], dy[i + j]);
+    }
+
+  return i;
+}
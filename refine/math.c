@@ -2,6 +2,22 @@
 #include <glib.h>
 #include "math.h"
 
+#include <p2t/poly2tri.h>
+#include <p2t/common/utils.h>
+
+/* The instruction sets of the batch predicates, see below */
+#if defined (__SSE2__)
+#define P2TR_MATH_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined (__AVX__) \
+    || ((defined (__x86_64__) || defined (__i386__)) \
+        && (defined (__clang__) || __GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)))
+#define P2TR_MATH_AVX
+#include <immintrin.h>
+#endif
+
 gdouble
 p2tr_math_length_sq (gdouble x1, gdouble y1,
                      gdouble x2, gdouble y2)
@@ -165,34 +181,153 @@ p2tr_math_intriangle2 (const P2trVector2 *A,
  * test, are both based on the work of Jonathan Richard Shewchuk. The
  * technique used here is described in his paper "Adaptive Precision
  * Floating-Point Arithmetic and Fast Robust Geometric Predicates"
+ *
+ * Both determinants are first computed in floating point, relative to
+ * the last point, along with the sum of the magnitudes of their terms.
+ * The rounding error of a determinant is at most a fixed fraction of
+ * that sum, so when the determinant is larger than that its sign is
+ * right, whatever the scale of the coordinates. The remaining close
+ * calls are decided by the exact adaptive predicates of poly2tri.
+ *
+ * The batch versions below compute the floating point determinants with
+ * exactly the same operations (only on several instances at once), so a
+ * test gives the same result wherever it is evaluated
  */
 
-#define ORIENT2D_EPSILON 1e-9
+/* 2^-53, the relative rounding error of a double operation */
+#define P2TR_MATH_EPSILON 1.1102230246251565e-16
 
-P2trOrientation p2tr_math_orient2d (const P2trVector2 *A,
-                                    const P2trVector2 *B,
-                                    const P2trVector2 *C)
+#define ORIENT2D_ERRBOUND ((3.0 + 16.0 * P2TR_MATH_EPSILON) * P2TR_MATH_EPSILON)
+
+/* We are trying to compute this determinant:
+ * |Ax Ay 1|
+ * |Bx By 1|
+ * |Cx Cy 1|
+ */
+static inline gdouble
+p2tr_math_orient2d_det (gdouble  ax, gdouble ay,
+                        gdouble  bx, gdouble by,
+                        gdouble  cx, gdouble cy,
+                        gdouble *detsum)
+{
+  gdouble detleft = (ax - cx) * (by - cy);
+  gdouble detright = (ay - cy) * (bx - cx);
+
+  *detsum = fabs (detleft) + fabs (detright);
+  return detleft - detright;
+}
+
+static P2trOrientation
+p2tr_math_orient2d_exact (gdouble ax, gdouble ay,
+                          gdouble bx, gdouble by,
+                          gdouble cx, gdouble cy)
 {
-  /* We are trying to compute this determinant:
-   * |Ax Ay 1|
-   * |Bx By 1|
-   * |Cx Cy 1|
-   */
-  gdouble result = p2tr_matrix_det3 (
-      A->x, A->y, 1,
-      B->x, B->y, 1,
-      C->x, C->y, 1
-  );
-
-  if (result > ORIENT2D_EPSILON)
+  P2tPoint a = { ax, ay }, b = { bx, by }, c = { cx, cy };
+  gdouble result = p2t_utils_orient2d (&a, &b, &c);
+
+  if (result > 0)
     return P2TR_ORIENTATION_CCW;
-  else if (result < ORIENT2D_EPSILON)
+  else if (result < 0)
     return P2TR_ORIENTATION_CW;
   else
     return P2TR_ORIENTATION_LINEAR;
 }
 
-#define INCIRCLE_EPSILON 1e-9
+static inline P2trOrientation
+p2tr_math_orient2d_classify (gdouble det, gdouble detsum,
+                             gdouble ax,  gdouble ay,
+                             gdouble bx,  gdouble by,
+                             gdouble cx,  gdouble cy)
+{
+  if (det > ORIENT2D_ERRBOUND * detsum)
+    return P2TR_ORIENTATION_CCW;
+  else if (-det > ORIENT2D_ERRBOUND * detsum)
+    return P2TR_ORIENTATION_CW;
+  else
+    return p2tr_math_orient2d_exact (ax, ay, bx, by, cx, cy);
+}
+
+P2trOrientation p2tr_math_orient2d (const P2trVector2 *A,
+                                    const P2trVector2 *B,
+                                    const P2trVector2 *C)
+{
+  gdouble detsum;
+  gdouble det = p2tr_math_orient2d_det (A->x, A->y, B->x, B->y,
+                                        C->x, C->y, &detsum);
+
+  return p2tr_math_orient2d_classify (det, detsum, A->x, A->y,
+                                      B->x, B->y, C->x, C->y);
+}
+
+#define INCIRCLE_ERRBOUND ((10.0 + 96.0 * P2TR_MATH_EPSILON) * P2TR_MATH_EPSILON)
+
+/* We are trying to compute this determinant:
+ * |Ax Ay Ax^2+Ay^2 1|
+ * |Bx By Bx^2+By^2 1|
+ * |Cx Cy Cx^2+Cy^2 1|
+ * |Dx Dy Dx^2+Dy^2 1|
+ * Subtracting the last row from all the others reduces it to a 3x3
+ * determinant of the coordinates relative to D
+ */
+static inline gdouble
+p2tr_math_incircle_det (gdouble  ax, gdouble ay,
+                        gdouble  bx, gdouble by,
+                        gdouble  cx, gdouble cy,
+                        gdouble  dx, gdouble dy,
+                        gdouble *permanent)
+{
+  gdouble adx = ax - dx, ady = ay - dy;
+  gdouble bdx = bx - dx, bdy = by - dy;
+  gdouble cdx = cx - dx, cdy = cy - dy;
+
+  gdouble bdxcdy = bdx * cdy, cdxbdy = cdx * bdy;
+  gdouble cdxady = cdx * ady, adxcdy = adx * cdy;
+  gdouble adxbdy = adx * bdy, bdxady = bdx * ady;
+
+  gdouble alift = adx * adx + ady * ady;
+  gdouble blift = bdx * bdx + bdy * bdy;
+  gdouble clift = cdx * cdx + cdy * cdy;
+
+  *permanent = alift * (fabs (bdxcdy) + fabs (cdxbdy))
+             + blift * (fabs (cdxady) + fabs (adxcdy))
+             + clift * (fabs (adxbdy) + fabs (bdxady));
+
+  return alift * (bdxcdy - cdxbdy)
+       + blift * (cdxady - adxcdy)
+       + clift * (adxbdy - bdxady);
+}
+
+static P2trInCircle
+p2tr_math_incircle_exact (gdouble ax, gdouble ay,
+                          gdouble bx, gdouble by,
+                          gdouble cx, gdouble cy,
+                          gdouble dx, gdouble dy)
+{
+  P2tPoint a = { ax, ay }, b = { bx, by }, c = { cx, cy }, d = { dx, dy };
+  gdouble result = p2t_utils_incircle (&a, &b, &c, &d);
+
+  if (result > 0)
+    return P2TR_INCIRCLE_IN;
+  else if (result < 0)
+    return P2TR_INCIRCLE_OUT;
+  else
+    return P2TR_INCIRCLE_ON;
+}
+
+static inline P2trInCircle
+p2tr_math_incircle_classify (gdouble det, gdouble permanent,
+                             gdouble ax,  gdouble ay,
+                             gdouble bx,  gdouble by,
+                             gdouble cx,  gdouble cy,
+                             gdouble dx,  gdouble dy)
+{
+  if (det > INCIRCLE_ERRBOUND * permanent)
+    return P2TR_INCIRCLE_IN;
+  else if (-det > INCIRCLE_ERRBOUND * permanent)
+    return P2TR_INCIRCLE_OUT;
+  else
+    return p2tr_math_incircle_exact (ax, ay, bx, by, cx, cy, dx, dy);
+}
 
 P2trInCircle
 p2tr_math_incircle (const P2trVector2 *A,
@@ -200,25 +335,154 @@ p2tr_math_incircle (const P2trVector2 *A,
                     const P2trVector2 *C,
                     const P2trVector2 *D)
 {
-  /* We are trying to compute this determinant:
-   * |Ax Ay Ax^2+Ay^2 1|
-   * |Bx By Bx^2+By^2 1|
-   * |Cx Cy Cx^2+Cy^2 1|
-   * |Dx Dy Dx^2+Dy^2 1|
-   */
-  gdouble result = p2tr_matrix_det4 (
-      A->x, A->y, P2TR_VECTOR2_LEN_SQ(A), 1,
-      B->x, B->y, P2TR_VECTOR2_LEN_SQ(B), 1,
-      C->x, C->y, P2TR_VECTOR2_LEN_SQ(C), 1,
-      D->x, D->y, P2TR_VECTOR2_LEN_SQ(D), 1
-  );
-
-  if (result > INCIRCLE_EPSILON)
-    return P2TR_INCIRCLE_IN;
-  else if (result < INCIRCLE_EPSILON)
-    return P2TR_INCIRCLE_OUT;
-  else
-    return P2TR_INCIRCLE_ON;
+  gdouble permanent;
+  gdouble det = p2tr_math_incircle_det (A->x, A->y, B->x, B->y,
+                                        C->x, C->y, D->x, D->y, &permanent);
+
+  return p2tr_math_incircle_classify (det, permanent, A->x, A->y, B->x, B->y,
+                                      C->x, C->y, D->x, D->y);
+}
+
+/* The batch predicates work on blocks of two SIMD vectors of instances
+ * (4 instances with SSE2, 8 with AVX). Whatever remains after the last
+ * full block, or everything when no SIMD instruction set is available,
+ * goes through the scalar code.
+ *
+ * The SSE2 kernels are used whenever the compiler targets SSE2, which
+ * every x86-64 processor has. The AVX kernels are compiled for AVX on
+ * their own, and used when the processor running the code supports it,
+ * so a default build still uses them on processors with AVX. When the
+ * whole library is built for AVX (-mavx), they are always used */
+#ifdef P2TR_MATH_SSE2
+#define P2trMathVec               __m128d
+#define P2TR_MATH_LANES           2
+#define P2TR_MATH_KERNEL(name)    name##_sse2
+#define P2TR_MATH_TARGET
+#define p2tr_math_vec_load(p)     _mm_loadu_pd (p)
+#define p2tr_math_vec_store(p,v)  _mm_storeu_pd (p, v)
+#define p2tr_math_vec_add(a,b)    _mm_add_pd (a, b)
+#define p2tr_math_vec_sub(a,b)    _mm_sub_pd (a, b)
+#define p2tr_math_vec_mul(a,b)    _mm_mul_pd (a, b)
+#define p2tr_math_vec_abs(a)      _mm_andnot_pd (_mm_set1_pd (-0.0), a)
+#include "math-batch.h"
+#undef P2trMathVec
+#undef P2TR_MATH_LANES
+#undef P2TR_MATH_KERNEL
+#undef P2TR_MATH_TARGET
+#undef p2tr_math_vec_load
+#undef p2tr_math_vec_store
+#undef p2tr_math_vec_add
+#undef p2tr_math_vec_sub
+#undef p2tr_math_vec_mul
+#undef p2tr_math_vec_abs
+#endif
+
+#ifdef P2TR_MATH_AVX
+#define P2trMathVec               __m256d
+#define P2TR_MATH_LANES           4
+#define P2TR_MATH_KERNEL(name)    name##_avx
+#if defined (__AVX__)
+#define P2TR_MATH_TARGET
+#else
+#define P2TR_MATH_TARGET          __attribute__ ((target ("avx")))
+#endif
+#define p2tr_math_vec_load(p)     _mm256_loadu_pd (p)
+#define p2tr_math_vec_store(p,v)  _mm256_storeu_pd (p, v)
+#define p2tr_math_vec_add(a,b)    _mm256_add_pd (a, b)
+#define p2tr_math_vec_sub(a,b)    _mm256_sub_pd (a, b)
+#define p2tr_math_vec_mul(a,b)    _mm256_mul_pd (a, b)
+#define p2tr_math_vec_abs(a)      _mm256_andnot_pd (_mm256_set1_pd (-0.0), a)
+#include "math-batch.h"
+#undef P2trMathVec
+#undef P2TR_MATH_LANES
+#undef P2TR_MATH_KERNEL
+#undef P2TR_MATH_TARGET
+#undef p2tr_math_vec_load
+#undef p2tr_math_vec_store
+#undef p2tr_math_vec_add
+#undef p2tr_math_vec_sub
+#undef p2tr_math_vec_mul
+#undef p2tr_math_vec_abs
+
+static inline gboolean
+p2tr_math_use_avx (void)
+{
+#if defined (__AVX__)
+  return TRUE;
+#else
+  return __builtin_cpu_supports ("avx");
+#endif
+}
+#endif
+
+void
+p2tr_math_orient2d_batch (const gdouble   *ax,
+                          const gdouble   *ay,
+                          const gdouble   *bx,
+                          const gdouble   *by,
+                          const gdouble   *cx,
+                          const gdouble   *cy,
+                          P2trOrientation *result,
+                          guint            n)
+{
+  guint i = 0;
+
+#ifdef P2TR_MATH_AVX
+  if (p2tr_math_use_avx ())
+    i = p2tr_math_orient2d_blocks_avx (ax, ay, bx, by, cx, cy, result, n);
+#endif
+
+#ifdef P2TR_MATH_SSE2
+  i += p2tr_math_orient2d_blocks_sse2 (ax + i, ay + i, bx + i, by + i,
+                                       cx + i, cy + i, result + i, n - i);
+#endif
+
+  for (; i < n; i++)
+    {
+      gdouble detsum;
+      gdouble det = p2tr_math_orient2d_det (ax[i], ay[i], bx[i], by[i],
+                                            cx[i], cy[i], &detsum);
+      result[i] = p2tr_math_orient2d_classify (det, detsum, ax[i], ay[i],
+                                               bx[i], by[i], cx[i], cy[i]);
+    }
+}
+
+void
+p2tr_math_incircle_batch (const gdouble *ax,
+                          const gdouble *ay,
+                          const gdouble *bx,
+                          const gdouble *by,
+                          const gdouble *cx,
+                          const gdouble *cy,
+                          const gdouble *dx,
+                          const gdouble *dy,
+                          P2trInCircle  *result,
+                          guint          n)
+{
+  guint i = 0;
+
+#ifdef P2TR_MATH_AVX
+  if (p2tr_math_use_avx ())
+    i = p2tr_math_incircle_blocks_avx (ax, ay, bx, by, cx, cy, dx, dy,
+                                       result, n);
+#endif
+
+#ifdef P2TR_MATH_SSE2
+  i += p2tr_math_incircle_blocks_sse2 (ax + i, ay + i, bx + i, by + i,
+                                       cx + i, cy + i, dx + i, dy + i,
+                                       result + i, n - i);
+#endif
+
+  for (; i < n; i++)
+    {
+      gdouble permanent;
+      gdouble det = p2tr_math_incircle_det (ax[i], ay[i], bx[i], by[i],
+                                            cx[i], cy[i], dx[i], dy[i],
+                                            &permanent);
+      result[i] = p2tr_math_incircle_classify (det, permanent,
+                                               ax[i], ay[i], bx[i], by[i],
+                                               cx[i], cy[i], dx[i], dy[i]);
+    }
 }
 
 /* The point inside diametral-circle test and the point inside diametral
@@ -90,6 +90,35 @@ P2trInCircle p2tr_math_incircle (const P2trVector2 *A,
                                  const P2trVector2 *C,
                                  const P2trVector2 *D);
 
+/**
+ * Batch versions of @ref p2tr_math_orient2d and @ref p2tr_math_incircle.
+ * The points of the i'th test are taken from the i'th element of each
+ * coordinate array, and its result is stored in the i'th element of
+ * @ref result. Both give exactly the same results as the single tests.
+ * With SSE2 several tests are evaluated at once, and with AVX even more
+ * when the processor running the code supports it (-mavx is not needed).
+ * @param[in] n The amount of tests to evaluate
+ */
+void p2tr_math_orient2d_batch (const gdouble   *ax,
+                               const gdouble   *ay,
+                               const gdouble   *bx,
+                               const gdouble   *by,
+                               const gdouble   *cx,
+                               const gdouble   *cy,
+                               P2trOrientation *result,
+                               guint            n);
+
+void p2tr_math_incircle_batch (const gdouble *ax,
+                               const gdouble *ay,
+                               const gdouble *bx,
+                               const gdouble *by,
+                               const gdouble *cx,
+                               const gdouble *cy,
+                               const gdouble *dx,
+                               const gdouble *dy,
+                               P2trInCircle  *result,
+                               guint          n);
+
 gboolean  p2tr_math_diametral_circle_contains (const P2trVector2 *X,
                                                const P2trVector2 *Y,
                                                const P2trVector2 *W);
@@ -1,3 +1,4 @@
+#include <math.h>
 #include <glib.h>
 #include "utils.h"
 
@@ -15,6 +16,8 @@ p2tr_mesh_new (void)
   mesh->edges = p2tr_hash_set_new_default ();
   mesh->points = p2tr_hash_set_new_default ();
   mesh->triangles = p2tr_hash_set_new_default ();
+  mesh->triangle_array = g_ptr_array_new ();
+  mesh->sample_seed = 0x9E3779B9;
 
   mesh->_is_clearing_now = FALSE;
 
@@ -75,6 +78,9 @@ p2tr_mesh_new_triangle (P2trMesh *self,
   p2tr_hash_set_insert (self->triangles, tr);
   p2tr_triangle_ref (tr);
 
+  tr->mesh_index = self->triangle_array->len;
+  g_ptr_array_add (self->triangle_array, tr);
+
   return tr;
 }
 
@@ -97,6 +103,10 @@ void
 p2tr_mesh_on_edge_removed (P2trMesh *self,
                            P2trEdge *edge)
 {
+  /* The mesh only holds the side of the edge which it created */
+  if (! p2tr_hash_set_contains (self->edges, edge))
+    edge = edge->mirror;
+
   if (! self->_is_clearing_now)
     p2tr_hash_set_remove (self->edges, edge);
   p2tr_edge_unref (edge);
@@ -107,7 +117,14 @@ p2tr_mesh_on_triangle_removed (P2trMesh     *self,
                                P2trTriangle *triangle)
 {
   if (! self->_is_clearing_now)
-    p2tr_hash_set_remove (self->triangles, triangle);
+    {
+      /* Move the last triangle of the array into the place of this one */
+      guint index = triangle->mesh_index;
+      p2tr_hash_set_remove (self->triangles, triangle);
+      g_ptr_array_remove_index_fast (self->triangle_array, index);
+      if (index < self->triangle_array->len)
+        ((P2trTriangle*) g_ptr_array_index (self->triangle_array, index))->mesh_index = index;
+    }
   p2tr_triangle_unref (triangle);
 }
 
@@ -123,6 +140,7 @@ p2tr_mesh_clear (P2trMesh *self)
   while (p2tr_hash_set_iter_next (&iter, &temp))
     p2tr_triangle_remove ((P2trTriangle*)temp);
   p2tr_hash_set_remove_all (self->triangles);
+  g_ptr_array_set_size (self->triangle_array, 0);
 
   p2tr_hash_set_iter_init (&iter, self->edges);
   while (p2tr_hash_set_iter_next (&iter, &temp))
@@ -145,6 +163,7 @@ p2tr_mesh_free (P2trMesh *self)
   p2tr_hash_set_free (self->points);
   p2tr_hash_set_free (self->edges);
   p2tr_hash_set_free (self->triangles);
+  g_ptr_array_free (self->triangle_array, TRUE);
 
   g_slice_free (P2trMesh, self);
 }
@@ -170,11 +189,12 @@ p2tr_mesh_find_point (P2trMesh *self,
   return p2tr_mesh_find_point2 (self, pt, &u, &v);
 }
 
-P2trTriangle*
-p2tr_mesh_find_point2 (P2trMesh          *self,
-                       const P2trVector2 *pt,
-                       gdouble           *u,
-                       gdouble           *v)
+/* Test the point against every triangle of the mesh */
+static P2trTriangle*
+p2tr_mesh_scan_for_point (P2trMesh          *self,
+                          const P2trVector2 *pt,
+                          gdouble           *u,
+                          gdouble           *v)
 {
   P2trHashSetIter iter;
   P2trTriangle *result;
@@ -187,6 +207,49 @@ p2tr_mesh_find_point2 (P2trMesh          *self,
   return NULL;
 }
 
+P2trTriangle*
+p2tr_mesh_find_point2 (P2trMesh          *self,
+                       const P2trVector2 *pt,
+                       gdouble           *u,
+                       gdouble           *v)
+{
+  guint n = self->triangle_array->len;
+  guint samples, i;
+  P2trTriangle *best = NULL;
+  gdouble best_distance_sq = G_MAXDOUBLE;
+
+  if (n == 0)
+    return NULL;
+
+  /* With n^(1/3) samples, the walk from the closest one is expected to
+   * take about as many steps as there are samples */
+  samples = (guint) ceil (pow (n, 1.0 / 3));
+
+  for (i = 0; i < samples; i++)
+    {
+      P2trTriangle *tri;
+      const P2trVector2 *c;
+      gdouble dx, dy;
+
+      self->sample_seed ^= self->sample_seed << 13;
+      self->sample_seed ^= self->sample_seed >> 17;
+      self->sample_seed ^= self->sample_seed << 5;
+
+      tri = (P2trTriangle*) g_ptr_array_index (self->triangle_array, self->sample_seed % n);
+      c = &P2TR_TRIANGLE_GET_POINT (tri, 0)->c;
+      dx = c->x - pt->x;
+      dy = c->y - pt->y;
+
+      if (dx * dx + dy * dy < best_distance_sq)
+        {
+          best = tri;
+          best_distance_sq = dx * dx + dy * dy;
+        }
+    }
+
+  return p2tr_mesh_find_point_local2 (self, pt, best, u, v);
+}
+
 P2trTriangle*
 p2tr_mesh_find_point_local (P2trMesh          *self,
                             const P2trVector2 *pt,
@@ -196,6 +259,127 @@ p2tr_mesh_find_point_local (P2trMesh          *self,
   return p2tr_mesh_find_point_local2 (self, pt, initial_guess, &u, &v);
 }
 
+/* The amount of steps, per triangle of the mesh, after which a walk is
+ * given up in favor of scanning all the triangles */
+#define P2TR_MESH_WALK_STEPS_PER_TRIANGLE 4
+
+/* The squared distance between a point and the segment of an edge. The
+ * parameter of the closest point along the edge is returned in t. When it
+ * is one of the ending points, the distance is computed from that point
+ * alone, so the two edges sharing it give exactly the same distance */
+static gdouble
+p2tr_mesh_edge_distance_sq (P2trEdge          *e,
+                            const P2trVector2 *pt,
+                            gdouble           *t)
+{
+  const P2trVector2 *A = &P2TR_EDGE_START (e)->c, *B = &e->end->c;
+  gdouble dx = B->x - A->x, dy = B->y - A->y;
+  gdouble len_sq = dx * dx + dy * dy;
+  gdouble px, py;
+
+  *t = (len_sq > 0) ? ((pt->x - A->x) * dx + (pt->y - A->y) * dy) / len_sq : 0;
+
+  if (*t <= 0)
+    {
+      *t = 0;
+      px = A->x - pt->x;
+      py = A->y - pt->y;
+    }
+  else if (*t >= 1)
+    {
+      *t = 1;
+      px = B->x - pt->x;
+      py = B->y - pt->y;
+    }
+  else
+    {
+      px = A->x + *t * dx - pt->x;
+      py = A->y + *t * dy - pt->y;
+    }
+  return px * px + py * py;
+}
+
+/* Given an edge of a triangle with no triangle on its other side, find
+ * the next such edge along the boundary of the mesh - either the one
+ * after its end point or the one before its start point. This rotates
+ * around the shared point through the triangles in between */
+static P2trEdge*
+p2tr_mesh_next_boundary_edge (P2trEdge *e,
+                              gboolean  forward)
+{
+  while (TRUE)
+    {
+      P2trTriangle *tri = e->tri;
+      P2trEdge *next;
+      gint i;
+
+      for (i = 0; i < 3; i++)
+        if (tri->edges[i] == e)
+          break;
+
+      next = tri->edges[(i + (forward ? 1 : 2)) % 3];
+      if (next->mirror->tri == NULL)
+        return next;
+      e = next->mirror;
+    }
+}
+
+/* Is the point beyond a boundary edge, on its side with no triangle? */
+static gboolean
+p2tr_mesh_beyond_edge (P2trEdge          *e,
+                       const P2trVector2 *pt)
+{
+  return p2tr_math_orient2d (&P2TR_EDGE_START (e)->c, &e->end->c, pt) == P2TR_ORIENTATION_CCW;
+}
+
+/* The walk was blocked by a boundary edge with the point beyond it, and
+ * no other edge of that part of the boundary is closer to the point. If
+ * the closest point of the edge is inside of it, the point is then outside
+ * of the domain: otherwise, the boundary would pass between the point and
+ * the edge, closer to it. If the closest point is an ending point of the
+ * edge, the same holds for the corner made with the next edge there, if
+ * that corner is convex. Around a reflex corner, the point is only outside
+ * if it's beyond both edges. Returns NULL if the point is outside, or else
+ * the boundary edge from which the walk should go on */
+static P2trEdge*
+p2tr_mesh_closest_boundary_edge (P2trEdge          *hit,
+                                 const P2trVector2 *pt)
+{
+  P2trEdge *in, *out;
+  gdouble t;
+
+  p2tr_mesh_edge_distance_sq (hit, pt, &t);
+  if (t > 0 && t < 1)
+    return NULL;
+
+  in = (t == 0) ? p2tr_mesh_next_boundary_edge (hit, FALSE) : hit;
+  out = (t == 0) ? hit : p2tr_mesh_next_boundary_edge (hit, TRUE);
+
+  /* The triangles are on the CW side of the boundary edges, so the corner
+   * between them is convex if the boundary turns CW there */
+  if (p2tr_math_orient2d (&P2TR_EDGE_START (in)->c, &in->end->c, &out->end->c) != P2TR_ORIENTATION_CCW
+      || p2tr_mesh_beyond_edge (in == hit ? out : in, pt))
+    return NULL;
+
+  return (in == hit) ? out : in;
+}
+
+/* This is a "remembering stochastic walk", as described by Olivier
+ * Devillers, Sylvain Pion and Monique Teillaud in "Walking in a
+ * Triangulation". From each triangle, the walk steps into a neighbor
+ * across an edge which separates the triangle from the point, never
+ * going back into the triangle it just came from. The edges are tried
+ * starting from a random one, so that the walk can't circle forever on
+ * meshes which are not Delaunay.
+ *
+ * The mesh may have holes and concavities, so the walk may reach edges
+ * with nothing beyond them. It then follows the boundary of the mesh in
+ * a random direction, until reaching an edge which is closer to the
+ * point than the one which blocked it, and walks towards the point again
+ * from there. If it comes back around to the blocking edge, that edge is
+ * the closest one of its part of the boundary, and tells whether the
+ * point is outside of the domain. Only if the walk takes too long are all
+ * the triangles scanned */
 P2trTriangle*
 p2tr_mesh_find_point_local2 (P2trMesh          *self,
                              const P2trVector2 *pt,
@@ -203,40 +387,92 @@ p2tr_mesh_find_point_local2 (P2trMesh          *self,
                              gdouble           *u,
                              gdouble           *v)
 {
-  P2trHashSet *checked_tris = p2tr_hash_set_new_default ();
-  GQueue to_check;
-  P2trTriangle *result = NULL;
-  
-  g_queue_init (&to_check);
-  
-  while (! g_queue_is_empty (&to_check))
+  P2trTriangle *tri = initial_guess, *prev = NULL;
+  P2trEdge *hit = NULL, *boundary = NULL;
+  gboolean forward = FALSE;
+  gdouble hit_distance_sq = 0, t;
+  guint32 seed = 0x9E3779B9;
+  guint steps, max_steps;
+
+  if (initial_guess == NULL)
+    return p2tr_mesh_find_point2 (self, pt, u, v);
+
+  max_steps = P2TR_MESH_WALK_STEPS_PER_TRIANGLE * p2tr_hash_set_size (self->triangles);
+
+  for (steps = 0; steps < max_steps; steps++)
     {
-      P2trTriangle *tri = (P2trTriangle*) g_queue_pop_head (&to_check);
-      
-      p2tr_hash_set_insert (checked_tris, tri);
-      if (p2tr_triangle_contains_point2 (tri, pt, u, v))
+      P2trTriangle *next = NULL;
+      P2trEdge *blocked = NULL;
+      gint i, first;
+
+      if (boundary != NULL)
         {
-          result = tri;
-          break;
+          boundary = p2tr_mesh_next_boundary_edge (boundary, forward);
+          if (boundary == hit)
+            {
+              if ((boundary = p2tr_mesh_closest_boundary_edge (hit, pt)) == NULL)
+                return NULL;
+
+              tri = boundary->tri;
+              prev = NULL;
+              boundary = NULL;
+              continue;
+            }
+
+          if (p2tr_mesh_edge_distance_sq (boundary, pt, &t) < hit_distance_sq)
+            {
+              tri = boundary->tri;
+              prev = NULL;
+              boundary = NULL;
+            }
+          continue;
+        }
+
+      /* A cheap xorshift is enough for choosing the first edge */
+      seed ^= seed << 13;
+      seed ^= seed >> 17;
+      seed ^= seed << 5;
+      first = seed % 3;
+
+      for (i = 0; i < 3 && next == NULL; i++)
+        {
+          P2trEdge *e = tri->edges[(first + i) % 3];
+          P2trTriangle *neighbor = e->mirror->tri;
+
+          /* The point can't be beyond the edge we just crossed towards
+           * it. Otherwise, since the triangle is on the CW side of each
+           * of its edges, the point is beyond the edge if it's on the
+           * CCW side */
+          if ((prev != NULL && neighbor == prev)
+              || p2tr_math_orient2d (&P2TR_EDGE_START (e)->c, &e->end->c, pt) != P2TR_ORIENTATION_CCW)
+            continue;
+
+          if (neighbor == NULL)
+            blocked = e;
+          else
+            next = neighbor;
+        }
+
+      if (next != NULL)
+        {
+          prev = tri;
+          tri = next;
+        }
+      else if (blocked != NULL)
+        {
+          /* Every way towards the point is blocked */
+          hit = boundary = blocked;
+          forward = seed & 0x100;
+          hit_distance_sq = p2tr_mesh_edge_distance_sq (blocked, pt, &t);
         }
       else
         {
-          gint i;
-          for (i = 0; i < 3; i++)
-            {
-              P2trTriangle *new_to_check = tri->edges[i]->mirror->tri;
-              if (new_to_check != NULL
-                  && ! p2tr_hash_set_contains (checked_tris, new_to_check))
-                {
-                  p2tr_hash_set_insert (checked_tris, new_to_check);
-                  g_queue_push_tail (&to_check, new_to_check);
-                }
-            }
+          /* The point isn't beyond any edge, so it's in this triangle */
+          if (p2tr_triangle_contains_point2 (tri, pt, u, v) != P2TR_INTRIANGLE_OUT)
+            return tri;
+          break;
         }
     }
 
-  p2tr_hash_set_free (checked_tris);
-  g_queue_clear (&to_check);
-
-  return result;
+  return p2tr_mesh_scan_for_point (self, pt, u, v);
 }
@@ -11,6 +11,11 @@ struct P2trMesh_
   P2trHashSet *triangles;
   P2trHashSet *edges;
   P2trHashSet *points;
+
+  /* All the triangles again, in an array which allows picking random
+   * triangles for locating points */
+  GPtrArray   *triangle_array;
+  guint32      sample_seed;
   
   guint        refcount;
   
@@ -63,6 +68,17 @@ void          p2tr_mesh_ref             (P2trMesh *mesh);
 P2trTriangle* p2tr_mesh_find_point      (P2trMesh *self,
                                          const P2trVector2 *pt);
 
+/** Find the triangle containing a point anywhere in the mesh, using the
+ *  "jump-and-walk" method: about n^(1/3) random triangles are sampled,
+ *  and the walk of @ref p2tr_mesh_find_point_local2 starts from the one
+ *  closest to the point
+ * @param[in] self The mesh to search
+ * @param[in] pt The point to find
+ * @param[out] u The u coordinate of the point inside the returned triangle
+ * @param[out] v The v coordinate of the point inside the returned triangle
+ * @return The triangle containing the point, or NULL if it's outside
+ *         the triangulation domain
+ */
 P2trTriangle* p2tr_mesh_find_point2     (P2trMesh          *self,
                                          const P2trVector2 *pt,
                                          gdouble           *u,
@@ -32,12 +32,10 @@ p2tr_point_remove (P2trPoint *self)
   while (self->outgoing_edges != NULL)
     p2tr_edge_remove ((P2trEdge*) self->outgoing_edges->data);
 
+  /* The mesh drops its reference to the point (which may free it) and the
+   * reference of the point to the mesh */
   if (self->mesh != NULL)
-  {
     p2tr_mesh_on_point_removed (self->mesh, self);
-    p2tr_mesh_unref (self->mesh);
-    self->mesh = NULL;
-  }
 }
 
 void
@@ -16,6 +16,7 @@
 #include "mesh.h"
 
 #include "cluster.h"
+#include "segment-index.h"
 #include "cdt.h"
 #include "delaunay-terminator.h"
 
@@ -0,0 +1,210 @@
+#include <math.h>
+
+#include <glib.h>
+#include "utils.h"
+#include "point.h"
+#include "edge.h"
+
+#include "segment-index.h"
+
+/* The largest amount of cells along each axis of the grid */
+#define P2TR_SEGMENT_INDEX_MAX_DIM 1024
+
+/* The amount of cells in the grid per expected segment */
+#define P2TR_SEGMENT_INDEX_CELLS_PER_SEGMENT 2
+
+/* The largest amount of cells a segment is listed in. Longer segments go
+ * to the list of long segments */
+#define P2TR_SEGMENT_INDEX_MAX_SEGMENT_CELLS 64
+
+P2trSegmentIndex*
+p2tr_segment_index_new (const P2trVector2 *min,
+                        const P2trVector2 *max,
+                        guint              n_segments)
+{
+  P2trSegmentIndex *self = g_slice_new (P2trSegmentIndex);
+  gdouble width = MAX (max->x - min->x, 0);
+  gdouble height = MAX (max->y - min->y, 0);
+  gdouble area = width * height;
+
+  /* Choose square cells so that there are a few of them per segment */
+  if (area > 0 && n_segments > 0)
+    self->cell_size = sqrt (area / (n_segments * P2TR_SEGMENT_INDEX_CELLS_PER_SEGMENT));
+  else
+    self->cell_size = MAX (MAX (width, height), 1);
+
+  self->min_x = min->x;
+  self->min_y = min->y;
+  self->nx = (guint) CLAMP (ceil (width / self->cell_size), 1, P2TR_SEGMENT_INDEX_MAX_DIM);
+  self->ny = (guint) CLAMP (ceil (height / self->cell_size), 1, P2TR_SEGMENT_INDEX_MAX_DIM);
+
+  self->cells = g_new0 (GPtrArray*, self->nx * self->ny);
+  self->long_segments = g_ptr_array_new ();
+  self->result = g_ptr_array_new ();
+
+  return self;
+}
+
+/* The cell of a coordinate along one axis, clamped into the grid */
+static inline guint
+p2tr_segment_index_cell_of (gdouble value,
+                            gdouble min,
+                            gdouble cell_size,
+                            guint   n)
+{
+  gdouble cell = floor ((value - min) / cell_size);
+  return (guint) CLAMP (cell, 0, n - 1);
+}
+
+/* Find the range of cells overlapped by the bounding box of the
+ * diametral circle of an edge */
+static void
+p2tr_segment_index_get_cells (P2trSegmentIndex *self,
+                              P2trEdge         *e,
+                              guint            *x0,
+                              guint            *y0,
+                              guint            *x1,
+                              guint            *y1)
+{
+  const P2trVector2 *X = &P2TR_EDGE_START (e)->c, *Y = &e->end->c;
+  gdouble cx = (X->x + Y->x) / 2, cy = (X->y + Y->y) / 2;
+  gdouble r = sqrt (p2tr_edge_get_length_squared (e)) / 2;
+
+  *x0 = p2tr_segment_index_cell_of (cx - r, self->min_x, self->cell_size, self->nx);
+  *x1 = p2tr_segment_index_cell_of (cx + r, self->min_x, self->cell_size, self->nx);
+  *y0 = p2tr_segment_index_cell_of (cy - r, self->min_y, self->cell_size, self->ny);
+  *y1 = p2tr_segment_index_cell_of (cy + r, self->min_y, self->cell_size, self->ny);
+}
+
+static void
+p2tr_segment_index_unref_edge (gpointer edge,
+                               gpointer user_data)
+{
+  p2tr_edge_unref ((P2trEdge*) edge);
+}
+
+void
+p2tr_segment_index_free (P2trSegmentIndex *self)
+{
+  guint i, j, x0, y0, x1, y1;
+
+  /* A segment listed in many cells holds a single reference, which is
+   * released in the last of its cells (so it is not looked at again) */
+  for (i = 0; i < self->nx * self->ny; i++)
+    if (self->cells[i] != NULL)
+      {
+        for (j = 0; j < self->cells[i]->len; j++)
+          {
+            P2trEdge *e = (P2trEdge*) g_ptr_array_index (self->cells[i], j);
+            p2tr_segment_index_get_cells (self, e, &x0, &y0, &x1, &y1);
+            if (y1 * self->nx + x1 == i)
+              p2tr_edge_unref (e);
+          }
+        g_ptr_array_free (self->cells[i], TRUE);
+      }
+
+  g_ptr_array_foreach (self->long_segments, p2tr_segment_index_unref_edge, NULL);
+  g_ptr_array_free (self->long_segments, TRUE);
+  g_ptr_array_free (self->result, TRUE);
+
+  g_free (self->cells);
+  g_slice_free (P2trSegmentIndex, self);
+}
+
+/* Whether an edge whose diametral circle overlaps the given range of
+ * cells is too long to be listed in the cells */
+static inline gboolean
+p2tr_segment_index_is_long (guint x0,
+                            guint y0,
+                            guint x1,
+                            guint y1)
+{
+  return (guint64) (x1 - x0 + 1) * (y1 - y0 + 1) > P2TR_SEGMENT_INDEX_MAX_SEGMENT_CELLS;
+}
+
+void
+p2tr_segment_index_add (P2trSegmentIndex *self,
+                        P2trEdge         *e)
+{
+  guint x, y, x0, y0, x1, y1;
+
+  p2tr_segment_index_get_cells (self, e, &x0, &y0, &x1, &y1);
+
+  if (p2tr_segment_index_is_long (x0, y0, x1, y1))
+    g_ptr_array_add (self->long_segments, e);
+  else
+    for (y = y0; y <= y1; y++)
+      for (x = x0; x <= x1; x++)
+        {
+          GPtrArray **cell = &self->cells[y * self->nx + x];
+          if (*cell == NULL)
+            *cell = g_ptr_array_new ();
+          g_ptr_array_add (*cell, e);
+        }
+
+  p2tr_edge_ref (e);
+}
+
+void
+p2tr_segment_index_remove (P2trSegmentIndex *self,
+                           P2trEdge         *e)
+{
+  P2trEdge *indexed = NULL;
+  guint x, y, x0, y0, x1, y1;
+
+  p2tr_segment_index_get_cells (self, e, &x0, &y0, &x1, &y1);
+
+  if (p2tr_segment_index_is_long (x0, y0, x1, y1))
+    {
+      if (g_ptr_array_remove_fast (self->long_segments, e))
+        indexed = e;
+      else if (g_ptr_array_remove_fast (self->long_segments, e->mirror))
+        indexed = e->mirror;
+    }
+  else
+    for (y = y0; y <= y1; y++)
+      for (x = x0; x <= x1; x++)
+        {
+          GPtrArray *cell = self->cells[y * self->nx + x];
+          if (cell == NULL)
+            continue;
+          if (g_ptr_array_remove_fast (cell, e))
+            indexed = e;
+          else if (g_ptr_array_remove_fast (cell, e->mirror))
+            indexed = e->mirror;
+        }
+
+  if (indexed == NULL)
+    p2tr_exception_programmatic ("The segment is not in the index!");
+
+  p2tr_edge_unref (indexed);
+}
+
+GPtrArray*
+p2tr_segment_index_query (P2trSegmentIndex  *self,
+                          const P2trVector2 *p)
+{
+  guint x = p2tr_segment_index_cell_of (p->x, self->min_x, self->cell_size, self->nx);
+  guint y = p2tr_segment_index_cell_of (p->y, self->min_y, self->cell_size, self->ny);
+  GPtrArray *cell = self->cells[y * self->nx + x];
+  guint i, x0, y0, x1, y1;
+
+  if (cell != NULL && self->long_segments->len == 0)
+    return cell;
+
+  /* Merge the cell (if it was ever allocated) with the long segments
+   * overlapping it */
+  g_ptr_array_set_size (self->result, 0);
+  for (i = 0; cell != NULL && i < cell->len; i++)
+    g_ptr_array_add (self->result, g_ptr_array_index (cell, i));
+
+  for (i = 0; i < self->long_segments->len; i++)
+    {
+      P2trEdge *e = (P2trEdge*) g_ptr_array_index (self->long_segments, i);
+      p2tr_segment_index_get_cells (self, e, &x0, &y0, &x1, &y1);
+      if (x0 <= x && x <= x1 && y0 <= y && y <= y1)
+        g_ptr_array_add (self->result, e);
+    }
+
+  return self->result;
+}
@@ -0,0 +1,74 @@
+#ifndef __P2TC_REFINE_SEGMENT_INDEX_H__
+#define __P2TC_REFINE_SEGMENT_INDEX_H__
+
+#include <glib.h>
+#include "vector2.h"
+#include "edge.h"
+
+/**
+ * A uniform grid over the constrained edges (subsegments) of a mesh.
+ * Each segment is listed in all the cells overlapped by the bounding box
+ * of its diametral circle, so the only segments whose diametral circle
+ * may contain a point are the ones listed in the cell of that point.
+ * Points outside of the grid belong to the nearest cell on its border.
+ * Segments which would be listed in too many cells (long segments of the
+ * input, before they are split) are kept in a separate list instead, which
+ * is checked for every point.
+ */
+typedef struct
+{
+  gdouble     min_x, min_y;
+  gdouble     cell_size;
+  guint       nx, ny;
+  /* nx * ny arrays of edges, row by row. A cell is only allocated once a
+   * segment is added to it, and is NULL until then */
+  GPtrArray **cells;
+  /* The segments which are not listed in the cells */
+  GPtrArray  *long_segments;
+  /* The result of a query, unless it is a single allocated cell */
+  GPtrArray  *result;
+} P2trSegmentIndex;
+
+/**
+ * Create an empty index for segments around the given area
+ * @param[in] min The lower corner of the area
+ * @param[in] max The upper corner of the area
+ * @param[in] n_segments The amount of segments expected in the index,
+ *            used to choose the size of the cells
+ * @return The new index, to be freed with @ref p2tr_segment_index_free
+ */
+P2trSegmentIndex* p2tr_segment_index_new    (const P2trVector2 *min,
+                                             const P2trVector2 *max,
+                                             guint              n_segments);
+
+/**
+ * Free an index, and release its references to the segments
+ */
+void              p2tr_segment_index_free   (P2trSegmentIndex *self);
+
+/**
+ * Add a segment to the index. The index keeps a reference to the edge
+ * until it is removed. Only one of the edge and its mirror should be added
+ */
+void              p2tr_segment_index_add    (P2trSegmentIndex *self,
+                                             P2trEdge         *e);
+
+/**
+ * Remove a segment from the index - either the edge which was added or
+ * its mirror may be given
+ */
+void              p2tr_segment_index_remove (P2trSegmentIndex *self,
+                                             P2trEdge         *e);
+
+/**
+ * Get the segments whose diametral circle may contain a point. THE
+ * RETURNED ARRAY BELONGS TO THE INDEX AND MUST NOT BE MODIFIED, and it is
+ * only valid until the next query or change of the index!
+ * @param[in] self The index to search
+ * @param[in] p The point
+ * @return An array of the candidate edges
+ */
+GPtrArray*        p2tr_segment_index_query  (P2trSegmentIndex  *self,
+                                             const P2trVector2 *p);
+
+#endif
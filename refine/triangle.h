@@ -14,6 +14,9 @@ struct P2trTriangle_
   P2trEdge* edges[3];
   
   guint refcount;
+
+  /* The position of the triangle in the triangle array of its mesh */
+  guint mesh_index;
 };
 
 P2trTriangle*   p2tr_triangle_new            (P2trEdge *AB,
@@ -0,0 +1,517 @@
+/*
+ * Tests of the refined mesh (refine)
+ */
+
+#include <math.h>
+#include <glib.h>
+
+#include <p2t/poly2tri.h>
+#include <refine/refine.h>
+
+/* A fixed jitter in [0, 1), so that the sweep gets the same points with
+ * any random generator */
+static gdouble
+test_jitter (guint i)
+{
+  return ((i * 53) % 97) / 97.0;
+}
+
+/* Enough copies of a test for the batch predicates to evaluate it in a
+ * block of the widest instruction set (AVX, when the processor has it), a
+ * block of SSE2 and the scalar remainder */
+#define TEST_BATCH_COPIES (8 + 4 + 3)
+
+/* Evaluate an orientation test in every lane of every kernel of the batch
+ * predicate, and check that they all agree with the single test */
+static P2trOrientation
+test_batch_orient2d (const P2trVector2 *a, const P2trVector2 *b, const P2trVector2 *c)
+{
+  gdouble ax[TEST_BATCH_COPIES], ay[TEST_BATCH_COPIES];
+  gdouble bx[TEST_BATCH_COPIES], by[TEST_BATCH_COPIES];
+  gdouble cx[TEST_BATCH_COPIES], cy[TEST_BATCH_COPIES];
+  P2trOrientation result[TEST_BATCH_COPIES];
+  P2trOrientation expected = p2tr_math_orient2d (a, b, c);
+  guint i;
+
+  for (i = 0; i < TEST_BATCH_COPIES; i++)
+    {
+      ax[i] = a->x; ay[i] = a->y;
+      bx[i] = b->x; by[i] = b->y;
+      cx[i] = c->x; cy[i] = c->y;
+    }
+
+  p2tr_math_orient2d_batch (ax, ay, bx, by, cx, cy, result, TEST_BATCH_COPIES);
+  for (i = 0; i < TEST_BATCH_COPIES; i++)
+    g_assert_cmpint (result[i], ==, expected);
+
+  return expected;
+}
+
+/* The same for an in-circle test */
+static P2trInCircle
+test_batch_incircle (const P2trVector2 *a, const P2trVector2 *b,
+                     const P2trVector2 *c, const P2trVector2 *d)
+{
+  gdouble ax[TEST_BATCH_COPIES], ay[TEST_BATCH_COPIES];
+  gdouble bx[TEST_BATCH_COPIES], by[TEST_BATCH_COPIES];
+  gdouble cx[TEST_BATCH_COPIES], cy[TEST_BATCH_COPIES];
+  gdouble dx[TEST_BATCH_COPIES], dy[TEST_BATCH_COPIES];
+  P2trInCircle result[TEST_BATCH_COPIES];
+  P2trInCircle expected = p2tr_math_incircle (a, b, c, d);
+  guint i;
+
+  for (i = 0; i < TEST_BATCH_COPIES; i++)
+    {
+      ax[i] = a->x; ay[i] = a->y;
+      bx[i] = b->x; by[i] = b->y;
+      cx[i] = c->x; cy[i] = c->y;
+      dx[i] = d->x; dy[i] = d->y;
+    }
+
+  p2tr_math_incircle_batch (ax, ay, bx, by, cx, cy, dx, dy, result, TEST_BATCH_COPIES);
+  for (i = 0; i < TEST_BATCH_COPIES; i++)
+    g_assert_cmpint (result[i], ==, expected);
+
+  return expected;
+}
+
+/* The SIMD kernels and the scalar code of the batch predicates classify
+ * random tests the same way, and near-degenerate ones exactly */
+static void
+test_batch_kernels (void)
+{
+  const gdouble offsets[] = { 0, 1024, 1e9 };
+  const gint on_circle[][2] = { { 7, 24 }, { -20, -15 }, { 24, -7 }, { -15, 20 } };
+  GRand *rand = g_rand_new_with_seed (29);
+  guint o, k;
+  gint i, j;
+
+  for (k = 0; k < 2000; k++)
+    {
+      P2trVector2 p[4];
+
+      for (i = 0; i < 4; i++)
+        {
+          p[i].x = g_rand_double_range (rand, -100, 100);
+          p[i].y = g_rand_double_range (rand, -100, 100);
+        }
+      test_batch_orient2d (&p[0], &p[1], &p[2]);
+      test_batch_incircle (&p[0], &p[1], &p[2], &p[3]);
+    }
+
+  for (o = 0; o < G_N_ELEMENTS (offsets); o++)
+    {
+      /* Points next to the line through b and c: the exact orientation is
+       * the side of the line */
+      const gdouble base = offsets[o] + 0.5;
+      const gdouble ulp = nextafter (base, G_MAXDOUBLE) - base;
+      P2trVector2 b = { offsets[o] + 12, offsets[o] + 12 };
+      P2trVector2 c = { offsets[o] + 24, offsets[o] + 24 };
+
+      for (i = -8; i <= 8; i++)
+        for (j = -8; j <= 8; j++)
+          {
+            P2trVector2 a = { base + i * ulp, base + j * ulp };
+            P2trOrientation expected = (j > i) ? P2TR_ORIENTATION_CCW
+                                     : (j < i) ? P2TR_ORIENTATION_CW
+                                     : P2TR_ORIENTATION_LINEAR;
+
+            g_assert_cmpint (test_batch_orient2d (&a, &b, &c), ==, expected);
+          }
+    }
+
+  for (o = 0; o < G_N_ELEMENTS (offsets); o++)
+    {
+      /* Points next to integer points of a circle of radius 25, which are
+       * inside of it when they moved towards the center */
+      const gdouble center = offsets[o];
+      const gdouble ulp = nextafter (center + 25, G_MAXDOUBLE) - (center + 25);
+      P2trVector2 a = { center + 25, center };
+      P2trVector2 b = { center, center + 25 };
+      P2trVector2 c = { center - 25, center };
+
+      for (k = 0; k < G_N_ELEMENTS (on_circle); k++)
+        for (i = -4; i <= 4; i++)
+          for (j = -4; j <= 4; j++)
+            {
+              const gint x = on_circle[k][0], y = on_circle[k][1];
+              P2trVector2 d = { center + x + i * ulp, center + y + j * ulp };
+              P2trInCircle expected = (x * i + y * j < 0) ? P2TR_INCIRCLE_IN
+                                    : (i == 0 && j == 0) ? P2TR_INCIRCLE_ON
+                                    : P2TR_INCIRCLE_OUT;
+
+              g_assert_cmpint (test_batch_incircle (&a, &b, &c, &d), ==, expected);
+            }
+    }
+
+  g_rand_free (rand);
+}
+
+/* A refined CDT of a jittered ring shaped polygon with a C shaped hole
+ * around its center, and a grid of Steiner points, so that walks between
+ * most points have to go around the hole. The points of the sweep are added
+ * to points */
+static P2trCDT*
+test_rcdt_new (GPtrArray *points)
+{
+  GPtrArray *outline = g_ptr_array_new ();
+  GPtrArray *hole = g_ptr_array_new ();
+  P2trCDT *rcdt;
+  P2tCDT *cdt;
+  guint i, j;
+
+  for (i = 0; i < 48; i++)
+    {
+      gdouble a = 2 * G_PI * i / 48, r = 80 + 20 * test_jitter (i);
+      g_ptr_array_add (outline, p2t_point_new_dd (r * cos (a), r * sin (a)));
+    }
+  for (i = 0; i <= 20; i++)
+    {
+      gdouble a = 0.3 + (2 * G_PI - 0.6) * i / 20, r = 48 + 4 * test_jitter (i + 100);
+      g_ptr_array_add (hole, p2t_point_new_dd (r * cos (a), r * sin (a)));
+    }
+  for (i = 0; i <= 20; i++)
+    {
+      gdouble a = 0.3 + (2 * G_PI - 0.6) * (20 - i) / 20, r = 38 + 4 * test_jitter (i + 200);
+      g_ptr_array_add (hole, p2t_point_new_dd (r * cos (a), r * sin (a)));
+    }
+
+  cdt = p2t_cdt_new (outline);
+  p2t_cdt_add_hole (cdt, hole);
+
+  for (i = 0; i < 16; i++)
+    for (j = 0; j < 16; j++)
+      {
+        gdouble x = -70 + 140 * (i + 0.4 + 0.2 * test_jitter (16 * i + j + 300)) / 16;
+        gdouble y = -70 + 140 * (j + 0.4 + 0.2 * test_jitter (16 * i + j + 5000)) / 16;
+        gdouble r = sqrt (x * x + y * y);
+
+        if (r < 75 && (r < 35 || r > 55))
+          {
+            P2tPoint *p = p2t_point_new_dd (x, y);
+            p2t_cdt_add_point (cdt, p);
+            g_ptr_array_add (points, p);
+          }
+      }
+
+  p2t_cdt_triangulate (cdt);
+  rcdt = p2tr_cdt_new (cdt);
+  p2t_cdt_free (cdt);
+
+  for (i = 0; i < outline->len; i++)
+    g_ptr_array_add (points, g_ptr_array_index (outline, i));
+  for (i = 0; i < hole->len; i++)
+    g_ptr_array_add (points, g_ptr_array_index (hole, i));
+  g_ptr_array_free (outline, TRUE);
+  g_ptr_array_free (hole, TRUE);
+
+  return rcdt;
+}
+
+static void
+test_free_points (GPtrArray *points)
+{
+  guint i;
+
+  for (i = 0; i < points->len; i++)
+    p2t_point_free (point_index (points, i));
+  g_ptr_array_free (points, TRUE);
+}
+
+/* Find the triangle containing a point by looking at all of them */
+static P2trTriangle*
+test_find_point_scan (P2trMesh *mesh, const P2trVector2 *p)
+{
+  guint i;
+
+  for (i = 0; i < mesh->triangle_array->len; i++)
+    {
+      P2trTriangle *tri = (P2trTriangle*) g_ptr_array_index (mesh->triangle_array, i);
+      if (p2tr_triangle_contains_point (tri, p) != P2TR_INTRIANGLE_OUT)
+        return tri;
+    }
+
+  return NULL;
+}
+
+/* Check the result of locating a point - either a triangle containing it,
+ * or NULL when no triangle of the mesh does */
+static void
+test_check_found (P2trMesh *mesh, const P2trVector2 *p, P2trTriangle *found)
+{
+  if (found == NULL)
+    g_assert_null (test_find_point_scan (mesh, p));
+  else
+    g_assert_true (p2tr_triangle_contains_point (found, p) != P2TR_INTRIANGLE_OUT);
+}
+
+/* Walks from random triangles reach points on the other side of the hole,
+ * and give up on points in the hole or outside of the polygon */
+static void
+test_find_point_local (void)
+{
+  GPtrArray *points = g_ptr_array_new ();
+  GRand *rand = g_rand_new_with_seed (3);
+  P2trCDT *rcdt = test_rcdt_new (points);
+  P2trMesh *mesh = rcdt->mesh;
+  guint i, found = 0;
+
+  for (i = 0; i < 2000; i++)
+    {
+      P2trVector2 p = { g_rand_double_range (rand, -110, 110),
+                        g_rand_double_range (rand, -110, 110) };
+      P2trTriangle *guess = (P2trTriangle*) g_ptr_array_index (mesh->triangle_array,
+          g_rand_int_range (rand, 0, mesh->triangle_array->len));
+      gdouble u, v;
+      P2trTriangle *tri = p2tr_mesh_find_point_local2 (mesh, &p, guess, &u, &v);
+
+      test_check_found (mesh, &p, tri);
+      found += tri != NULL;
+    }
+
+  /* About half of the bounding box is inside of the polygon */
+  g_assert_cmpuint (found, >, 500);
+
+  p2tr_cdt_free (rcdt);
+  g_rand_free (rand);
+  test_free_points (points);
+}
+
+/* Add a small triangle around (x, y), not connected to the rest of the
+ * mesh */
+static void
+test_island_new (P2trMesh *mesh, gdouble x, gdouble y)
+{
+  P2trVector2 ca = { x - 2, y - 2 }, cb = { x + 2, y - 2 }, cc = { x, y + 2 };
+  P2trPoint *A = p2tr_mesh_new_point (mesh, &ca);
+  P2trPoint *B = p2tr_mesh_new_point (mesh, &cb);
+  P2trPoint *C = p2tr_mesh_new_point (mesh, &cc);
+  P2trEdge *AB = p2tr_mesh_new_edge (mesh, A, B, TRUE);
+  P2trEdge *BC = p2tr_mesh_new_edge (mesh, B, C, TRUE);
+  P2trEdge *CA = p2tr_mesh_new_edge (mesh, C, A, TRUE);
+
+  p2tr_triangle_unref (p2tr_mesh_new_triangle (mesh, AB, BC, CA));
+  p2tr_edge_unref (AB);
+  p2tr_edge_unref (BC);
+  p2tr_edge_unref (CA);
+  p2tr_point_unref (A);
+  p2tr_point_unref (B);
+  p2tr_point_unref (C);
+}
+
+/* Walks towards points outside of the domain decide so from the boundary,
+ * without scanning all the triangles. Scanning would find the triangles
+ * of the islands, which the walks can't reach */
+static void
+test_find_point_exterior (void)
+{
+  GPtrArray *points = g_ptr_array_new ();
+  GRand *rand = g_rand_new_with_seed (9);
+  P2trCDT *rcdt = test_rcdt_new (points);
+  P2trMesh *mesh = rcdt->mesh;
+  const guint n = mesh->triangle_array->len;
+  /* Outside of the polygon, and in its hole */
+  const P2trVector2 islands[] = { { 150, 20 }, { -45, 0 } };
+  guint i, j;
+
+  for (j = 0; j < G_N_ELEMENTS (islands); j++)
+    test_island_new (mesh, islands[j].x, islands[j].y);
+
+  for (i = 0; i < 2000; i++)
+    {
+      P2trTriangle *guess = (P2trTriangle*) g_ptr_array_index (mesh->triangle_array,
+          g_rand_int_range (rand, 0, n));
+      P2trVector2 p = { g_rand_double_range (rand, -0.5, 0.5),
+                        g_rand_double_range (rand, -0.5, 0.5) };
+      gdouble u, v;
+
+      j = i % G_N_ELEMENTS (islands);
+      p.x += islands[j].x;
+      p.y += islands[j].y;
+      g_assert_nonnull (test_find_point_scan (mesh, &p));
+      g_assert_null (p2tr_mesh_find_point_local2 (mesh, &p, guess, &u, &v));
+    }
+
+  /* Anywhere else, the walks agree with the scan */
+  for (i = 0; i < 2000; i++)
+    {
+      P2trTriangle *guess = (P2trTriangle*) g_ptr_array_index (mesh->triangle_array,
+          g_rand_int_range (rand, 0, n));
+      P2trVector2 p = { g_rand_double_range (rand, -110, 110),
+                        g_rand_double_range (rand, -110, 110) };
+      gdouble u, v;
+
+      if (fabs (p.x - islands[1].x) < 3 && fabs (p.y - islands[1].y) < 3)
+        continue;
+      test_check_found (mesh, &p, p2tr_mesh_find_point_local2 (mesh, &p, guess, &u, &v));
+    }
+
+  p2tr_cdt_free (rcdt);
+  g_rand_free (rand);
+  test_free_points (points);
+}
+
+/* Jump-and-walk finds the points anywhere in the mesh, also after the mesh
+ * changed */
+static void
+test_find_point_jump (void)
+{
+  GPtrArray *points = g_ptr_array_new ();
+  GRand *rand = g_rand_new_with_seed (5);
+  P2trCDT *rcdt = test_rcdt_new (points);
+  P2trMesh *mesh = rcdt->mesh;
+  guint round, i, inserted = 0;
+
+  for (round = 0; round < 3; round++)
+    {
+      for (i = 0; i < 1000; i++)
+        {
+          P2trVector2 p = { g_rand_double_range (rand, -110, 110),
+                            g_rand_double_range (rand, -110, 110) };
+          gdouble u, v;
+
+          test_check_found (mesh, &p, p2tr_mesh_find_point2 (mesh, &p, &u, &v));
+          test_check_found (mesh, &p, p2tr_mesh_find_point (mesh, &p));
+        }
+
+      /* Insert points without a guess, so they are located by jump-and-walk
+       * as well, and the triangles they replace leave the mesh */
+      while (inserted < 200 * (round + 1))
+        {
+          P2trVector2 p = { g_rand_double_range (rand, -90, 90),
+                            g_rand_double_range (rand, -90, 90) };
+
+          if (test_find_point_scan (mesh, &p) != NULL)
+            {
+              p2tr_point_unref (p2tr_cdt_insert_point (rcdt, &p, NULL));
+              inserted++;
+            }
+        }
+    }
+
+  p2tr_cdt_validate_cdt (rcdt);
+
+  p2tr_cdt_free (rcdt);
+  g_rand_free (rand);
+  test_free_points (points);
+}
+
+/* A batch of points inserted in BRIO order keeps the mesh a valid CDT, and
+ * the returned points are the given ones */
+static void
+test_insert_points (void)
+{
+  GPtrArray *points = g_ptr_array_new ();
+  GRand *rand = g_rand_new_with_seed (11);
+  P2trCDT *rcdt = test_rcdt_new (points);
+  guint n_tris = rcdt->mesh->triangle_array->len;
+  guint n_points = 0, i;
+  P2trVector2 batch[2000];
+  P2trPoint *result[2000];
+
+  while (n_points < G_N_ELEMENTS (batch))
+    {
+      P2trVector2 p = { g_rand_double_range (rand, -100, 100),
+                        g_rand_double_range (rand, -100, 100) };
+
+      if (test_find_point_scan (rcdt->mesh, &p) != NULL)
+        batch[n_points++] = p;
+    }
+
+  p2tr_cdt_insert_points (rcdt, batch, n_points, result);
+
+  for (i = 0; i < n_points; i++)
+    {
+      g_assert_cmpfloat (result[i]->c.x, ==, batch[i].x);
+      g_assert_cmpfloat (result[i]->c.y, ==, batch[i].y);
+      g_assert_true (result[i]->mesh == rcdt->mesh);
+      p2tr_point_unref (result[i]);
+    }
+
+  /* Each point inside of a triangle replaces it with three */
+  g_assert_cmpuint (rcdt->mesh->triangle_array->len, ==, n_tris + 2 * n_points);
+  p2tr_cdt_validate_edges (rcdt);
+  p2tr_cdt_validate_cdt (rcdt);
+
+  p2tr_cdt_free (rcdt);
+  g_rand_free (rand);
+  test_free_points (points);
+}
+
+/* Splitting all the segments and inserting points restores the CDT each
+ * time, and leaves the work space of the CDT empty for the next change */
+static void
+test_flip_fix (void)
+{
+  GPtrArray *points = g_ptr_array_new ();
+  GPtrArray *segments = g_ptr_array_new ();
+  GRand *rand = g_rand_new_with_seed (13);
+  P2trCDT *rcdt = test_rcdt_new (points);
+  P2trHashSetIter iter;
+  P2trEdge *e;
+  guint i, inserted = 0;
+
+  p2tr_hash_set_iter_init (&iter, rcdt->mesh->edges);
+  while (p2tr_hash_set_iter_next (&iter, (gpointer*)&e))
+    if (e->constrained)
+      {
+        p2tr_edge_ref (e);
+        g_ptr_array_add (segments, e);
+      }
+
+  for (i = 0; i < segments->len; i++)
+    {
+      P2trEdge *segment = (P2trEdge*) g_ptr_array_index (segments, i);
+      P2trVector2 m = { (P2TR_EDGE_START (segment)->c.x + segment->end->c.x) / 2,
+                        (P2TR_EDGE_START (segment)->c.y + segment->end->c.y) / 2 };
+      P2trPoint *C = p2tr_mesh_new_point (rcdt->mesh, &m);
+      GList *parts = p2tr_cdt_split_edge (rcdt, segment, C), *l;
+
+      for (l = parts; l != NULL; l = l->next)
+        p2tr_edge_unref ((P2trEdge*) l->data);
+      g_list_free (parts);
+      p2tr_point_unref (C);
+      p2tr_edge_unref (segment);
+    }
+
+  while (inserted < 500)
+    {
+      P2trVector2 p = { g_rand_double_range (rand, -100, 100),
+                        g_rand_double_range (rand, -100, 100) };
+      P2trTriangle *tri = test_find_point_scan (rcdt->mesh, &p);
+
+      if (tri != NULL)
+        {
+          p2tr_point_unref (p2tr_cdt_insert_point (rcdt, &p, tri));
+          inserted++;
+        }
+    }
+
+  g_assert_cmpuint (rcdt->tris_to_fix->len, ==, 0);
+  g_assert_cmpuint (rcdt->flipped_edges->len, ==, 0);
+  g_assert_cmpuint (rcdt->cavity->len, ==, 0);
+  g_assert_cmpuint (rcdt->bad_tris->len, ==, 0);
+  g_assert_cmpuint (p2tr_hash_set_size (rcdt->visited), ==, 0);
+  p2tr_cdt_validate_edges (rcdt);
+  p2tr_cdt_validate_cdt (rcdt);
+
+  g_ptr_array_free (segments, TRUE);
+  p2tr_cdt_free (rcdt);
+  g_rand_free (rand);
+  test_free_points (points);
+}
+
+int
+main (int argc, char *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/refine/math/batch-kernels", test_batch_kernels);
+  g_test_add_func ("/refine/find-point/local", test_find_point_local);
+  g_test_add_func ("/refine/find-point/exterior", test_find_point_exterior);
+  g_test_add_func ("/refine/find-point/jump", test_find_point_jump);
+  g_test_add_func ("/refine/insert-points/validate", test_insert_points);
+  g_test_add_func ("/refine/flip-fix/split-and-insert", test_flip_fix);
+
+  return g_test_run ();
+}
@@ -0,0 +1,1204 @@
+/*
+ * Tests of the sweep triangulation (p2t/sweep)
+ */
+
+#include <math.h>
+#include <string.h>
+#include <glib.h>
+
+#include <p2t/poly2tri.h>
+#include <p2t/common/utils.h>
+
+/* Twice the signed area of a triangle, positive when it is CCW */
+static gdouble
+test_orient (const P2tPoint *a, const P2tPoint *b, const P2tPoint *c)
+{
+  return (b->x - a->x) * (c->y - a->y) - (b->y - a->y) * (c->x - a->x);
+}
+
+/* Check that all the triangles of the CDT are CCW, and return their total
+ * area */
+static gdouble
+test_triangles_area (P2tCDT *cdt)
+{
+  P2tTrianglePtrArray triangles = p2t_cdt_get_triangles (cdt);
+  gdouble area = 0;
+  guint i;
+
+  for (i = 0; i < triangles->len; i++)
+    {
+      P2tTriangle *t = triangle_index (triangles, i);
+      gdouble a = test_orient (p2t_triangle_get_point (t, 0),
+                               p2t_triangle_get_point (t, 1),
+                               p2t_triangle_get_point (t, 2));
+
+      g_assert_cmpfloat (a, >, 0);
+      area += a / 2;
+    }
+
+  return area;
+}
+
+/* Check that the constrained Delaunay property holds across every edge
+ * between two interior triangles */
+static void
+test_check_delaunay (P2tCDT *cdt)
+{
+  P2tTrianglePtrArray triangles = p2t_cdt_get_triangles (cdt);
+  guint i;
+  int j;
+
+  for (i = 0; i < triangles->len; i++)
+    for (j = 0; j < 3; j++)
+      {
+        P2tTriangle *t = triangle_index (triangles, i);
+        P2tTriangle *u = p2t_triangle_get_neighbor (t, j);
+        P2tPoint *p = p2t_triangle_get_point (t, j);
+
+        if (u == NULL || ! p2t_triangle_is_interior (u)
+            || p2t_triangle_get_constrained_edge_i (t, j))
+          continue;
+
+        g_assert_cmpfloat (p2t_utils_incircle (p, p2t_triangle_point_ccw (t, p),
+                                               p2t_triangle_point_cw (t, p),
+                                               p2t_triangle_opposite_point (u, t, p)), <=, 0);
+      }
+}
+
+/* Whether p-q is a constrained edge of two interior triangles (or of one,
+ * on the boundary of the polygon) */
+static gboolean
+test_has_constrained_edge (P2tCDT *cdt, P2tPoint *p, P2tPoint *q)
+{
+  P2tTrianglePtrArray triangles = p2t_cdt_get_triangles (cdt);
+  guint i, found = 0;
+
+  for (i = 0; i < triangles->len; i++)
+    {
+      P2tTriangle *t = triangle_index (triangles, i);
+      int index = p2t_triangle_edge_index (t, p, q);
+
+      if (index == -1)
+        continue;
+      if (! p2t_triangle_get_constrained_edge_i (t, index))
+        return FALSE;
+      found++;
+    }
+
+  return found > 0;
+}
+
+/* Count the constrained edges of the interior triangles, once per side */
+static guint
+test_count_constrained (P2tCDT *cdt)
+{
+  P2tTrianglePtrArray triangles = p2t_cdt_get_triangles (cdt);
+  guint i, count = 0;
+  int j;
+
+  for (i = 0; i < triangles->len; i++)
+    for (j = 0; j < 3; j++)
+      count += p2t_triangle_get_constrained_edge_i (triangle_index (triangles, i), j) ? 1 : 0;
+
+  return count;
+}
+
+/* A CDT of a polygon given as (x, y) pairs. The points are owned by the
+ * caller, who frees them with test_free_points */
+static P2tCDT*
+test_cdt_new (const gdouble *xy, guint n_points, GPtrArray *points)
+{
+  GPtrArray *polyline = g_ptr_array_new ();
+  P2tCDT *cdt;
+  guint i;
+
+  for (i = 0; i < n_points; i++)
+    {
+      P2tPoint *p = p2t_point_new_dd (xy[2 * i], xy[2 * i + 1]);
+      g_ptr_array_add (polyline, p);
+      g_ptr_array_add (points, p);
+    }
+
+  cdt = p2t_cdt_new (polyline);
+  g_ptr_array_free (polyline, TRUE);
+  return cdt;
+}
+
+static P2tPoint*
+test_point_new (GPtrArray *points, gdouble x, gdouble y)
+{
+  P2tPoint *p = p2t_point_new_dd (x, y);
+  g_ptr_array_add (points, p);
+  return p;
+}
+
+static void
+test_free_points (GPtrArray *points)
+{
+  guint i;
+
+  for (i = 0; i < points->len; i++)
+    p2t_point_free (point_index (points, i));
+  g_ptr_array_free (points, TRUE);
+}
+
+/* A ring of n jittered points around (cx, cy), added to points */
+static GPtrArray*
+test_ring_new (GPtrArray *points, GRand *rand, gdouble cx, gdouble cy,
+               gdouble r, guint n)
+{
+  GPtrArray *polyline = g_ptr_array_new ();
+  guint i;
+
+  for (i = 0; i < n; i++)
+    {
+      gdouble a = 2 * G_PI * i / n;
+      gdouble s = r * g_rand_double_range (rand, 0.8, 1);
+      g_ptr_array_add (polyline, test_point_new (points, cx + s * cos (a),
+                                                 cy + s * sin (a)));
+    }
+
+  return polyline;
+}
+
+/* Check that two index arrays are the same */
+static void
+test_assert_same_indices (GArray *a, GArray *b)
+{
+  g_assert_cmpuint (a->len, ==, b->len);
+  g_assert_true (memcmp (a->data, b->data, a->len * sizeof (guint32)) == 0);
+}
+
+/* Check that the neighbors of the indexed triangles are symmetric: the
+ * neighbor across an edge has the same edge, with the triangle across it.
+ * Returns the amount of edges without a neighbor */
+static guint
+test_check_neighbors (GArray *indices, GArray *neighbors)
+{
+  const guint n = indices->len / 3;
+  guint i, open = 0;
+  int j, k;
+
+  g_assert_cmpuint (neighbors->len, ==, indices->len);
+
+  for (i = 0; i < n; i++)
+    for (j = 0; j < 3; j++)
+      {
+        guint32 u = g_array_index (neighbors, guint32, 3 * i + j), found = 0;
+        guint32 a = g_array_index (indices, guint32, 3 * i + (j + 1) % 3);
+        guint32 b = g_array_index (indices, guint32, 3 * i + (j + 2) % 3);
+
+        if (u == P2T_CDT_NO_NEIGHBOR)
+          {
+            open++;
+            continue;
+          }
+
+        g_assert_cmpuint (u, <, n);
+        for (k = 0; k < 3; k++)
+          if (g_array_index (neighbors, guint32, 3 * u + k) == i)
+            {
+              /* The edge opposite to k, in the other direction */
+              g_assert_cmpuint (g_array_index (indices, guint32, 3 * u + (k + 1) % 3), ==, b);
+              g_assert_cmpuint (g_array_index (indices, guint32, 3 * u + (k + 2) % 3), ==, a);
+              found++;
+            }
+        g_assert_cmpuint (found, ==, 1);
+      }
+
+  return open;
+}
+
+/* The indices of a polygon triangulated on its own */
+static GArray*
+test_polygon_indices (const P2tCDTPolygon *polygon)
+{
+  P2tCDT *cdt = p2t_cdt_new (polygon->polyline);
+  GArray *indices = g_array_new (FALSE, FALSE, sizeof (guint32));
+  guint i;
+
+  if (polygon->holes != NULL)
+    for (i = 0; i < polygon->holes->len; i++)
+      p2t_cdt_add_hole (cdt, g_ptr_array_index (polygon->holes, i));
+  p2t_cdt_triangulate (cdt);
+  p2t_cdt_get_indices (cdt, indices, NULL);
+  p2t_cdt_free (cdt);
+
+  return indices;
+}
+
+/* Fill polygons with rings of various sizes, every third one with a hole.
+ * The last polygon reuses the points of the first one */
+static void
+test_polygons_new (P2tCDTPolygon *polygons, guint n, GPtrArray *points,
+                   GRand *rand)
+{
+  guint i;
+
+  for (i = 0; i + 1 < n; i++)
+    {
+      polygons[i].polyline = test_ring_new (points, rand, 0, 0, 4, 10 + 7 * (i % 20));
+      polygons[i].holes = NULL;
+      if (i % 3 == 0)
+        {
+          polygons[i].holes = g_ptr_array_new ();
+          g_ptr_array_add (polygons[i].holes, test_ring_new (points, rand, 0, 0, 1.5, 8 + i % 10));
+        }
+    }
+
+  polygons[n - 1].polyline = g_ptr_array_ref (polygons[0].polyline);
+  polygons[n - 1].holes = g_ptr_array_ref (polygons[0].holes);
+}
+
+static void
+test_polygons_free (P2tCDTPolygon *polygons, guint n)
+{
+  guint i;
+
+  for (i = 0; i < n; i++)
+    {
+      if (polygons[i].holes != NULL && i + 1 < n)
+        g_ptr_array_free (g_ptr_array_index (polygons[i].holes, 0), TRUE);
+      if (polygons[i].holes != NULL)
+        g_ptr_array_unref (polygons[i].holes);
+      g_ptr_array_unref (polygons[i].polyline);
+    }
+}
+
+/* A batch gives the same indices as triangulating each polygon on its own,
+ * whatever the amount of threads, also for polygons sharing their points */
+static void
+test_batch_threads (void)
+{
+  GPtrArray *points = g_ptr_array_new ();
+  GRand *rand = g_rand_new_with_seed (17);
+  P2tCDTPolygon polygons[120];
+  const guint n = G_N_ELEMENTS (polygons);
+  const guint n_threads[] = { 1, 2, 4, 0 };
+  GPtrArray *expected = g_ptr_array_new_with_free_func ((GDestroyNotify) g_array_unref);
+  guint i, t;
+
+  test_polygons_new (polygons, n, points, rand);
+  for (i = 0; i < n; i++)
+    g_ptr_array_add (expected, test_polygon_indices (&polygons[i]));
+
+  for (t = 0; t < G_N_ELEMENTS (n_threads); t++)
+    {
+      GPtrArray *results = p2t_cdt_triangulate_batch (polygons, n, n_threads[t]);
+
+      g_assert_cmpuint (results->len, ==, n);
+      for (i = 0; i < n; i++)
+        test_assert_same_indices (g_ptr_array_index (results, i),
+                                  g_ptr_array_index (expected, i));
+      g_ptr_array_free (results, TRUE);
+    }
+
+  g_ptr_array_free (expected, TRUE);
+  test_polygons_free (polygons, n);
+  g_rand_free (rand);
+  test_free_points (points);
+}
+
+/* A CDT reset for each polygon of a stream gives the same indices and
+ * neighbors as a new CDT for each of them, with or without an arena */
+static void
+test_reset_reuse (void)
+{
+  GPtrArray *points = g_ptr_array_new ();
+  GRand *rand = g_rand_new_with_seed (19);
+  P2tCDTPolygon polygons[40];
+  const guint n = G_N_ELEMENTS (polygons);
+  const P2tCDTFlags flags[] = { P2T_CDT_DEFAULT, P2T_CDT_USE_ARENA };
+  GArray *indices = g_array_new (FALSE, FALSE, sizeof (guint32));
+  GArray *neighbors = g_array_new (FALSE, FALSE, sizeof (guint32));
+  GArray *expected = g_array_new (FALSE, FALSE, sizeof (guint32));
+  GArray *expected_neighbors = g_array_new (FALSE, FALSE, sizeof (guint32));
+  guint f, i, j;
+
+  test_polygons_new (polygons, n, points, rand);
+
+  for (f = 0; f < G_N_ELEMENTS (flags); f++)
+    {
+      P2tCDT *reused = NULL;
+
+      for (i = 0; i < n; i++)
+        {
+          P2tCDT *cdt = p2t_cdt_new_full (polygons[i].polyline, flags[f]);
+          P2tPoint *steiner = test_point_new (points, 0.1 * i / n, 0.2);
+
+          if (reused == NULL)
+            reused = p2t_cdt_new_full (polygons[i].polyline, flags[f]);
+          else
+            p2t_cdt_reset (reused, polygons[i].polyline);
+
+          if (polygons[i].holes != NULL)
+            for (j = 0; j < polygons[i].holes->len; j++)
+              {
+                p2t_cdt_add_hole (cdt, g_ptr_array_index (polygons[i].holes, j));
+                p2t_cdt_add_hole (reused, g_ptr_array_index (polygons[i].holes, j));
+              }
+          else
+            {
+              p2t_cdt_add_point (cdt, steiner);
+              p2t_cdt_add_point (reused, steiner);
+            }
+
+          p2t_cdt_triangulate (cdt);
+          p2t_cdt_triangulate (reused);
+          p2t_cdt_get_indices (cdt, expected, expected_neighbors);
+          p2t_cdt_get_indices (reused, indices, neighbors);
+          test_assert_same_indices (indices, expected);
+          test_assert_same_indices (neighbors, expected_neighbors);
+          p2t_cdt_free (cdt);
+        }
+
+      p2t_cdt_free (reused);
+    }
+
+  g_array_free (indices, TRUE);
+  g_array_free (neighbors, TRUE);
+  g_array_free (expected, TRUE);
+  g_array_free (expected_neighbors, TRUE);
+  test_polygons_free (polygons, n);
+  g_rand_free (rand);
+  test_free_points (points);
+}
+
+/* The neighbors of the indexed output are symmetric, and the only edges
+ * without a neighbor are the constrained edges of the outline and the hole */
+static void
+test_indices_neighbors (void)
+{
+  GPtrArray *points = g_ptr_array_new ();
+  GRand *rand = g_rand_new_with_seed (23);
+  GPtrArray *outline = test_ring_new (points, rand, 0, 0, 10, 60);
+  GPtrArray *hole = test_ring_new (points, rand, 1, 0, 3, 25);
+  GArray *indices = g_array_new (FALSE, FALSE, sizeof (guint32));
+  GArray *neighbors = g_array_new (FALSE, FALSE, sizeof (guint32));
+  P2tCDT *cdt = p2t_cdt_new (outline);
+  P2tTrianglePtrArray triangles;
+  guint i;
+  int j;
+
+  p2t_cdt_add_hole (cdt, hole);
+  for (i = 0; i < 30; i++)
+    p2t_cdt_add_point (cdt, test_point_new (points, -6 + 0.3 * i, -5 + 0.2 * (i % 7)));
+  p2t_cdt_triangulate (cdt);
+  p2t_cdt_get_indices (cdt, indices, neighbors);
+
+  g_assert_cmpuint (test_check_neighbors (indices, neighbors), ==, outline->len + hole->len);
+
+  triangles = p2t_cdt_get_triangles (cdt);
+  g_assert_cmpuint (indices->len, ==, 3 * triangles->len);
+  for (i = 0; i < triangles->len; i++)
+    for (j = 0; j < 3; j++)
+      if (g_array_index (neighbors, guint32, 3 * i + j) == P2T_CDT_NO_NEIGHBOR)
+        g_assert_true (p2t_triangle_get_constrained_edge_i (triangle_index (triangles, i), j));
+
+  g_array_free (indices, TRUE);
+  g_array_free (neighbors, TRUE);
+  p2t_cdt_free (cdt);
+  g_ptr_array_free (outline, TRUE);
+  g_ptr_array_free (hole, TRUE);
+  g_rand_free (rand);
+  test_free_points (points);
+}
+
+static gint
+test_sign (gdouble value)
+{
+  return (value > 0) - (value < 0);
+}
+
+/* The orientation of points next to the line through (12, 12) and (24, 24),
+ * on a grid of the smallest steps around (0.5, 0.5), and the same shifted
+ * far away from the origin. The exact sign is the side of the line, which
+ * plain floating point gets wrong for many of them */
+static void
+test_predicates_orient2d (void)
+{
+  const gdouble offsets[] = { 0, 1024, 1e9 };
+  guint o, wrong = 0;
+  gint i, j;
+
+  for (o = 0; o < G_N_ELEMENTS (offsets); o++)
+    {
+      const gdouble base = offsets[o] + 0.5;
+      const gdouble ulp = nextafter (base, G_MAXDOUBLE) - base;
+      P2tPoint b = { offsets[o] + 12, offsets[o] + 12 };
+      P2tPoint c = { offsets[o] + 24, offsets[o] + 24 };
+
+      for (i = -16; i <= 16; i++)
+        for (j = -16; j <= 16; j++)
+          {
+            P2tPoint a = { base + i * ulp, base + j * ulp };
+            gdouble naive = (a.x - c.x) * (b.y - c.y) - (a.y - c.y) * (b.x - c.x);
+            gint expected = test_sign (j - i);
+
+            g_assert_cmpint (test_sign (p2t_utils_orient2d (&a, &b, &c)), ==, expected);
+            g_assert_cmpint (test_sign (p2t_utils_orient2d (&b, &c, &a)), ==, expected);
+            g_assert_cmpint (test_sign (p2t_utils_orient2d (&c, &a, &b)), ==, expected);
+            g_assert_cmpint (test_sign (p2t_utils_orient2d (&b, &a, &c)), ==, -expected);
+            wrong += test_sign (naive) != expected;
+          }
+    }
+
+  /* Make sure that these are hard cases */
+  g_assert_cmpuint (wrong, >, 100);
+}
+
+/* The in-circle test of points on a grid of the smallest steps around points
+ * of a circle of radius 25, with and without large offsets. The circle goes
+ * through integer points, so the exact sign can be computed from the grid */
+static void
+test_predicates_incircle (void)
+{
+  const gdouble offsets[] = { 0, 1024, 1e9, 1e12 };
+  const gint on_circle[][2] = { { 7, 24 }, { -20, -15 }, { 24, -7 }, { -15, 20 } };
+  guint o, k, wrong = 0;
+  gint i, j;
+
+  for (o = 0; o < G_N_ELEMENTS (offsets); o++)
+    {
+      const gdouble center = offsets[o];
+      const gdouble ulp = nextafter (center + 25, G_MAXDOUBLE) - (center + 25);
+      P2tPoint a = { center + 25, center };
+      P2tPoint b = { center, center + 25 };
+      P2tPoint c = { center - 25, center };
+
+      for (k = 0; k < G_N_ELEMENTS (on_circle); k++)
+        for (i = -8; i <= 8; i++)
+          for (j = -8; j <= 8; j++)
+            {
+              const gint x = on_circle[k][0], y = on_circle[k][1];
+              P2tPoint d = { center + x + i * ulp, center + y + j * ulp };
+              gdouble adx = a.x - d.x, ady = a.y - d.y;
+              gdouble bdx = b.x - d.x, bdy = b.y - d.y;
+              gdouble cdx = c.x - d.x, cdy = c.y - d.y;
+              gdouble naive = (adx * adx + ady * ady) * (bdx * cdy - cdx * bdy)
+                            + (bdx * bdx + bdy * bdy) * (cdx * ady - adx * cdy)
+                            + (cdx * cdx + cdy * cdy) * (adx * bdy - bdx * ady);
+              /* The squared distance of d from the center minus 25^2 is
+               * 2 (x i + y j) ulp + (i^2 + j^2) ulp^2, so d is outside when
+               * x i + y j is positive, or when it is zero and d moved */
+              gint expected = (x * i + y * j != 0) ? -test_sign (x * i + y * j)
+                            : -test_sign (i * i + j * j);
+
+              g_assert_cmpint (test_sign (p2t_utils_incircle (&a, &b, &c, &d)), ==, expected);
+              g_assert_cmpint (test_sign (p2t_utils_incircle (&b, &c, &a, &d)), ==, expected);
+              g_assert_cmpint (test_sign (p2t_utils_incircle (&c, &a, &b, &d)), ==, expected);
+              wrong += test_sign (naive) != expected;
+            }
+    }
+
+  /* Make sure that these are hard cases */
+  g_assert_cmpuint (wrong, >, 20);
+}
+
+/* A 10x10 square with a 2x2 square hole, as packed (x, y) pairs */
+static const gdouble square_with_hole[] = {
+  0, 0,  10, 0,  10, 10,  0, 10,
+  4, 4,  4, 6,  6, 6,  6, 4
+};
+
+static void
+test_from_xy_packed (void)
+{
+  const gsize hole_offsets[] = { 4 };
+  P2tCDT *cdt = p2t_cdt_new_from_xy (square_with_hole, 2, 8, hole_offsets, 1, 0);
+  GArray *indices = g_array_new (FALSE, FALSE, sizeof (guint32));
+  P2tTrianglePtrArray triangles;
+  guint i, j;
+
+  p2t_cdt_triangulate (cdt);
+  triangles = p2t_cdt_get_triangles (cdt);
+
+  /* A polygon with n points and h holes has n + 2h - 2 triangles */
+  g_assert_cmpuint (triangles->len, ==, 8);
+  g_assert_cmpfloat (test_triangles_area (cdt), ==, 96);
+
+  /* The points are the ones of the buffer, and keep their positions as
+   * indices */
+  p2t_cdt_get_indices (cdt, indices, NULL);
+  g_assert_cmpuint (indices->len, ==, 3 * triangles->len);
+  for (i = 0; i < triangles->len; i++)
+    for (j = 0; j < 3; j++)
+      {
+        P2tPoint *p = p2t_triangle_get_point (triangle_index (triangles, i), j);
+        guint32 index = g_array_index (indices, guint32, 3 * i + j);
+
+        g_assert_cmpuint (index, <, 8);
+        g_assert_true ((const gdouble*) p == square_with_hole + 2 * index);
+      }
+
+  g_array_free (indices, TRUE);
+  p2t_cdt_free (cdt);
+}
+
+static void
+test_from_xy_strided (void)
+{
+  const gsize hole_offsets[] = { 4 };
+  gdouble xyz[3 * 8];
+  GArray *indices = g_array_new (FALSE, FALSE, sizeof (guint32));
+  GArray *expected = g_array_new (FALSE, FALSE, sizeof (guint32));
+  P2tCDT *cdt;
+  guint i;
+
+  /* The same polygon, with a third coordinate between the points */
+  for (i = 0; i < 8; i++)
+    {
+      xyz[3 * i] = square_with_hole[2 * i];
+      xyz[3 * i + 1] = square_with_hole[2 * i + 1];
+      xyz[3 * i + 2] = NAN;
+    }
+
+  cdt = p2t_cdt_new_from_xy (square_with_hole, 2, 8, hole_offsets, 1, 0);
+  p2t_cdt_triangulate (cdt);
+  p2t_cdt_get_indices (cdt, expected, NULL);
+  p2t_cdt_free (cdt);
+
+  cdt = p2t_cdt_new_from_xy (xyz, 3, 8, hole_offsets, 1, 0);
+  p2t_cdt_triangulate (cdt);
+  g_assert_cmpfloat (test_triangles_area (cdt), ==, 96);
+  p2t_cdt_get_indices (cdt, indices, NULL);
+  p2t_cdt_free (cdt);
+
+  g_assert_cmpuint (indices->len, ==, expected->len);
+  for (i = 0; i < indices->len; i++)
+    g_assert_cmpuint (g_array_index (indices, guint32, i), ==,
+                      g_array_index (expected, guint32, i));
+
+  g_array_free (indices, TRUE);
+  g_array_free (expected, TRUE);
+}
+
+static void
+test_from_xy_steiner (void)
+{
+  /* A Steiner point added to a CDT of a buffer is numbered after the
+   * points of the buffer */
+  P2tCDT *cdt = p2t_cdt_new_from_xy (square_with_hole, 2, 4, NULL, 0, 0);
+  P2tPoint *steiner = p2t_point_new_dd (2, 3);
+  GArray *indices = g_array_new (FALSE, FALSE, sizeof (guint32));
+  gboolean found = FALSE;
+  guint i;
+
+  p2t_cdt_add_point (cdt, steiner);
+  p2t_cdt_triangulate (cdt);
+  g_assert_cmpuint (p2t_cdt_get_triangles (cdt)->len, ==, 4);
+  g_assert_cmpfloat (test_triangles_area (cdt), ==, 100);
+
+  p2t_cdt_get_indices (cdt, indices, NULL);
+  for (i = 0; i < indices->len; i++)
+    {
+      g_assert_cmpuint (g_array_index (indices, guint32, i), <=, 4);
+      found |= g_array_index (indices, guint32, i) == 4;
+    }
+  g_assert_true (found);
+
+  g_array_free (indices, TRUE);
+  p2t_cdt_free (cdt);
+  p2t_point_free (steiner);
+}
+
+static const gdouble square[] = { 0, 0,  10, 0,  10, 10,  0, 10 };
+
+/* A U shape, with a notch coming down from its top edge */
+static const gdouble notched[] = {
+  0, 0,  3, 0,  3, 3,  2, 3,  2, 1,  1, 1,  1, 3,  0, 3
+};
+
+/* An M shape, with a deep V coming down from its top edge */
+static const gdouble v_shape[] = {
+  0, 0,  4, 0,  4, 4,  3.9, 4,  2, 0.2,  0.1, 4,  0, 4
+};
+
+static void
+test_insert_point_inside (void)
+{
+  GPtrArray *points = g_ptr_array_new ();
+  P2tCDT *cdt = test_cdt_new (square, 4, points);
+  GArray *indices = g_array_new (FALSE, FALSE, sizeof (guint32));
+  gboolean found[6] = { FALSE };
+  guint i;
+
+  p2t_cdt_triangulate (cdt);
+  g_assert_true (p2t_cdt_insert_point (cdt, test_point_new (points, 3, 4)));
+  g_assert_true (p2t_cdt_insert_point (cdt, test_point_new (points, 5, 0)));
+  g_assert_cmpuint (p2t_cdt_get_triangles (cdt)->len, ==, 5);
+  g_assert_cmpfloat (test_triangles_area (cdt), ==, 100);
+  test_check_delaunay (cdt);
+
+  /* The inserted points are numbered after the points of the polygon */
+  p2t_cdt_get_indices (cdt, indices, NULL);
+  for (i = 0; i < indices->len; i++)
+    {
+      g_assert_cmpuint (g_array_index (indices, guint32, i), <, 6);
+      found[g_array_index (indices, guint32, i)] = TRUE;
+    }
+  g_assert_true (found[4] && found[5]);
+
+  g_array_free (indices, TRUE);
+  p2t_cdt_free (cdt);
+  test_free_points (points);
+}
+
+static void
+test_insert_point_outside (void)
+{
+  const gsize hole_offsets[] = { 4 };
+  GPtrArray *points = g_ptr_array_new ();
+  P2tCDT *cdt = p2t_cdt_new_from_xy (square_with_hole, 2, 8, hole_offsets, 1, 0);
+
+  p2t_cdt_triangulate (cdt);
+  g_assert_false (p2t_cdt_insert_point (cdt, test_point_new (points, 20, 5)));
+  g_assert_false (p2t_cdt_insert_point (cdt, test_point_new (points, -1, -1)));
+  g_assert_false (p2t_cdt_insert_point (cdt, test_point_new (points, 5, 5)));
+  g_assert_false (p2t_cdt_insert_point (cdt, test_point_new (points, 10, 10)));
+  g_assert_cmpuint (p2t_cdt_get_triangles (cdt)->len, ==, 8);
+  g_assert_cmpfloat (test_triangles_area (cdt), ==, 96);
+
+  p2t_cdt_free (cdt);
+  test_free_points (points);
+}
+
+static void
+test_insert_point_many (void)
+{
+  const gsize hole_offsets[] = { 4 };
+  GPtrArray *points = g_ptr_array_new ();
+  P2tCDT *cdt = p2t_cdt_new_from_xy (square_with_hole, 2, 8, hole_offsets, 1, 0);
+  GRand *rand = g_rand_new_with_seed (42);
+  guint i, inserted = 0;
+
+  p2t_cdt_triangulate (cdt);
+  for (i = 0; i < 500; i++)
+    {
+      gdouble x = g_rand_double_range (rand, 0, 10);
+      gdouble y = g_rand_double_range (rand, 0, 10);
+      gboolean in_hole = x >= 4 && x <= 6 && y >= 4 && y <= 6;
+
+      g_assert_true (p2t_cdt_insert_point (cdt, test_point_new (points, x, y)) == ! in_hole);
+      inserted += ! in_hole;
+    }
+
+  g_assert_cmpuint (p2t_cdt_get_triangles (cdt)->len, ==, 8 + 2 * inserted);
+  g_assert_cmpfloat_with_epsilon (test_triangles_area (cdt), 96, 1e-9);
+  test_check_delaunay (cdt);
+
+  g_rand_free (rand);
+  p2t_cdt_free (cdt);
+  test_free_points (points);
+}
+
+/* Walking from one arm of a polygon to the other leaves the polygon, and
+ * passes through the dent which the advancing front has above the V */
+static void
+test_insert_point_across_dent (void)
+{
+  GPtrArray *points = g_ptr_array_new ();
+  P2tCDT *cdt = test_cdt_new (v_shape, 7, points);
+  guint i;
+
+  p2t_cdt_triangulate (cdt);
+  for (i = 0; i < 10; i++)
+    {
+      g_assert_true (p2t_cdt_insert_point (cdt, test_point_new (points, 0.05, 3.9 - 0.3 * i)));
+      g_assert_true (p2t_cdt_insert_point (cdt, test_point_new (points, 3.95, 3.9 - 0.3 * i)));
+    }
+  g_assert_false (p2t_cdt_insert_point (cdt, test_point_new (points, 2, 3)));
+  g_assert_false (p2t_cdt_insert_point (cdt, test_point_new (points, 2, 5)));
+
+  g_assert_cmpuint (p2t_cdt_get_triangles (cdt)->len, ==, 5 + 2 * 20);
+  test_check_delaunay (cdt);
+
+  p2t_cdt_free (cdt);
+  test_free_points (points);
+}
+
+static void
+test_insert_edge_crossing (void)
+{
+  GPtrArray *points = g_ptr_array_new ();
+  P2tCDT *cdt = test_cdt_new (square, 4, points);
+  GRand *rand = g_rand_new_with_seed (7);
+  P2tPoint *p, *q;
+  guint i;
+
+  p2t_cdt_triangulate (cdt);
+  for (i = 0; i < 100; i++)
+    p2t_cdt_insert_point (cdt, test_point_new (points, g_rand_double_range (rand, 0.5, 9.5),
+                                               g_rand_double_range (rand, 0.5, 9.5)));
+
+  /* An edge crossing many triangles */
+  p = test_point_new (points, 0.25, 1.5);
+  q = test_point_new (points, 9.75, 8.25);
+  g_assert_true (p2t_cdt_insert_edge (cdt, p, q));
+  g_assert_true (test_has_constrained_edge (cdt, p, q));
+  g_assert_cmpuint (p2t_cdt_get_triangles (cdt)->len, ==, 2 + 2 * 102);
+  g_assert_cmpfloat_with_epsilon (test_triangles_area (cdt), 100, 1e-9);
+  test_check_delaunay (cdt);
+
+  /* An edge from a corner, going through an existing point */
+  p = test_point_new (points, 2, 2);
+  q = test_point_new (points, 4, 4);
+  g_assert_true (p2t_cdt_insert_point (cdt, p));
+  g_assert_true (p2t_cdt_insert_edge (cdt, test_point_new (points, 0, 0), q));
+  g_assert_true (test_has_constrained_edge (cdt, point_index (points, 0), p));
+  g_assert_true (test_has_constrained_edge (cdt, p, q));
+  test_check_delaunay (cdt);
+
+  /* An edge crossing a constrained edge is rejected */
+  i = test_count_constrained (cdt);
+  g_assert_false (p2t_cdt_insert_edge (cdt, test_point_new (points, 1, 9),
+                                       test_point_new (points, 9, 1)));
+  g_assert_cmpuint (test_count_constrained (cdt), ==, i);
+
+  g_rand_free (rand);
+  p2t_cdt_free (cdt);
+  test_free_points (points);
+}
+
+/* Many long edges, each crossing many triangles. The inserted points are
+ * part of the indexed output */
+static void
+test_insert_edge_many (void)
+{
+  GPtrArray *points = g_ptr_array_new ();
+  P2tCDT *cdt = test_cdt_new (square, 4, points);
+  GArray *indices = g_array_new (FALSE, FALSE, sizeof (guint32));
+  GRand *rand = g_rand_new_with_seed (11);
+  guint i;
+
+  p2t_cdt_triangulate (cdt);
+  for (i = 0; i < 300; i++)
+    g_assert_true (p2t_cdt_insert_point (cdt, test_point_new (points, g_rand_double_range (rand, 0.2, 9.8),
+                                                              g_rand_double_range (rand, 0.2, 9.8))));
+
+  for (i = 0; i < 30; i++)
+    {
+      P2tPoint *p = test_point_new (points, 0.1, 0.15 + 0.32 * i);
+      P2tPoint *q = test_point_new (points, 9.9, 0.25 + 0.32 * i);
+
+      g_assert_true (p2t_cdt_insert_edge (cdt, p, q));
+      g_assert_true (test_has_constrained_edge (cdt, p, q));
+    }
+
+  g_assert_cmpuint (p2t_cdt_get_triangles (cdt)->len, ==, 2 + 2 * (300 + 60));
+  g_assert_cmpfloat_with_epsilon (test_triangles_area (cdt), 100, 1e-9);
+  test_check_delaunay (cdt);
+
+  p2t_cdt_get_indices (cdt, indices, NULL);
+  g_assert_cmpuint (indices->len, ==, 3 * p2t_cdt_get_triangles (cdt)->len);
+  for (i = 0; i < indices->len; i++)
+    g_assert_cmpuint (g_array_index (indices, guint32, i), <, points->len);
+
+  g_array_free (indices, TRUE);
+  g_rand_free (rand);
+  p2t_cdt_free (cdt);
+  test_free_points (points);
+}
+
+static void
+test_insert_edge_exterior (void)
+{
+  const gsize hole_offsets[] = { 4 };
+  GPtrArray *points = g_ptr_array_new ();
+  P2tCDT *cdt = p2t_cdt_new_from_xy (square_with_hole, 2, 8, hole_offsets, 1, 0);
+  guint constrained;
+
+  p2t_cdt_triangulate (cdt);
+  constrained = test_count_constrained (cdt);
+
+  /* Outside of the polygon, or in its hole */
+  g_assert_false (p2t_cdt_insert_edge (cdt, test_point_new (points, -2, 1),
+                                       test_point_new (points, -1, 9)));
+  g_assert_false (p2t_cdt_insert_edge (cdt, test_point_new (points, 4.5, 4.5),
+                                       test_point_new (points, 5.5, 5.5)));
+  /* From the inside to the outside, or to the hole */
+  g_assert_false (p2t_cdt_insert_edge (cdt, test_point_new (points, 1, 1),
+                                       test_point_new (points, 11, 1)));
+  g_assert_false (p2t_cdt_insert_edge (cdt, test_point_new (points, 2, 5),
+                                       test_point_new (points, 5, 5)));
+  /* Across the hole */
+  g_assert_false (p2t_cdt_insert_edge (cdt, test_point_new (points, 3, 5),
+                                       test_point_new (points, 7, 5)));
+  /* Across the hole, between two of its points */
+  g_assert_false (p2t_cdt_insert_edge (cdt, (P2tPoint*) &square_with_hole[8],
+                                       (P2tPoint*) &square_with_hole[12]));
+
+  g_assert_cmpuint (test_count_constrained (cdt), ==, constrained);
+  g_assert_cmpfloat_with_epsilon (test_triangles_area (cdt), 96, 1e-9);
+
+  p2t_cdt_free (cdt);
+  test_free_points (points);
+}
+
+/* Edges across the notch of a U, whose points are points of the polygon or
+ * lie on its boundary, leave the polygon */
+static void
+test_insert_edge_notch (void)
+{
+  GPtrArray *points = g_ptr_array_new ();
+  P2tCDT *cdt = test_cdt_new (notched, 8, points);
+  P2tPoint *p, *q;
+
+  p2t_cdt_triangulate (cdt);
+  g_assert_false (p2t_cdt_insert_edge (cdt, test_point_new (points, 1, 3),
+                                       test_point_new (points, 2, 3)));
+  g_assert_false (p2t_cdt_insert_edge (cdt, test_point_new (points, 1, 2.5),
+                                       test_point_new (points, 2, 2.5)));
+  g_assert_false (p2t_cdt_insert_edge (cdt, test_point_new (points, 0.5, 2),
+                                       test_point_new (points, 2.5, 2)));
+  g_assert_false (p2t_cdt_insert_edge (cdt, test_point_new (points, 0.5, 2.5),
+                                       test_point_new (points, 1.5, 0.5)));
+  g_assert_cmpfloat_with_epsilon (test_triangles_area (cdt), 7, 1e-9);
+
+  /* Below the notch, and along the boundary */
+  p = test_point_new (points, 0.5, 0.25);
+  q = test_point_new (points, 2.5, 0.25);
+  g_assert_true (p2t_cdt_insert_edge (cdt, p, q));
+  g_assert_true (test_has_constrained_edge (cdt, p, q));
+  g_assert_true (p2t_cdt_insert_edge (cdt, test_point_new (points, 0, 0),
+                                      test_point_new (points, 3, 0)));
+  g_assert_true (p2t_cdt_insert_edge (cdt, point_index (points, 2),
+                                      point_index (points, 3)));
+  test_check_delaunay (cdt);
+
+  p2t_cdt_free (cdt);
+  test_free_points (points);
+}
+
+/* Count the triangles of the map, and the interior ones among them */
+static void
+test_collect_triangle (P2tTriangle *triangle, gpointer collected)
+{
+  g_ptr_array_add ((GPtrArray*) collected, triangle);
+}
+
+/* Check that the triangle function got each interior triangle once, in the
+ * order of p2t_cdt_get_triangles */
+static void
+test_assert_collected (P2tCDT *cdt, GPtrArray *collected)
+{
+  P2tTrianglePtrArray triangles = p2t_cdt_get_triangles (cdt);
+
+  g_assert_cmpuint (triangles->len, >, 0);
+  g_assert_cmpuint (collected->len, ==, triangles->len);
+  g_assert_true (memcmp (collected->pdata, triangles->pdata,
+                         triangles->len * sizeof (gpointer)) == 0);
+}
+
+static void
+test_triangle_func (void)
+{
+  GPtrArray *points = g_ptr_array_new ();
+  GPtrArray *polylines = g_ptr_array_new ();
+  GPtrArray *collected = g_ptr_array_new ();
+  GRand *rand = g_rand_new_with_seed (5);
+  P2tCDT *cdt;
+  guint i;
+
+  g_ptr_array_add (polylines, test_ring_new (points, rand, 0, 0, 4, 60));
+  g_ptr_array_add (polylines, test_ring_new (points, rand, 0, 0, 1.5, 20));
+  g_ptr_array_add (polylines, test_ring_new (points, rand, 10, 0, 4, 40));
+  g_ptr_array_add (polylines, test_ring_new (points, rand, 20, 0, 4, 50));
+
+  cdt = p2t_cdt_new (g_ptr_array_index (polylines, 0));
+  p2t_cdt_add_hole (cdt, g_ptr_array_index (polylines, 1));
+  p2t_cdt_set_triangle_func (cdt, test_collect_triangle, collected);
+  p2t_cdt_triangulate (cdt);
+  test_assert_collected (cdt, collected);
+
+  /* Inserted points don't go through the function */
+  i = collected->len;
+  g_assert_true (p2t_cdt_insert_point (cdt, test_point_new (points, 2.5, 0.5)));
+  g_assert_cmpuint (collected->len, ==, i);
+
+  /* The function is kept across a reset, until it is unset */
+  g_ptr_array_set_size (collected, 0);
+  p2t_cdt_reset (cdt, g_ptr_array_index (polylines, 2));
+  p2t_cdt_triangulate (cdt);
+  test_assert_collected (cdt, collected);
+
+  g_ptr_array_set_size (collected, 0);
+  p2t_cdt_set_triangle_func (cdt, NULL, NULL);
+  p2t_cdt_reset (cdt, g_ptr_array_index (polylines, 3));
+  p2t_cdt_triangulate (cdt);
+  g_assert_cmpuint (collected->len, ==, 0);
+  p2t_cdt_free (cdt);
+
+  /* Several outlines, triangulated by several threads */
+  cdt = p2t_cdt_new_multi (polylines, 0);
+  p2t_cdt_set_triangle_func (cdt, test_collect_triangle, collected);
+  p2t_cdt_triangulate (cdt);
+  test_assert_collected (cdt, collected);
+  p2t_cdt_free (cdt);
+
+  for (i = 0; i < polylines->len; i++)
+    g_ptr_array_free (g_ptr_array_index (polylines, i), TRUE);
+  g_ptr_array_free (polylines, TRUE);
+  g_ptr_array_free (collected, TRUE);
+  g_rand_free (rand);
+  test_free_points (points);
+}
+
+static guint
+test_count_map (P2tCDT *cdt, guint *n_interior)
+{
+  P2tTriangleMapIter iter;
+  P2tTriangle *t;
+  guint count = 0;
+
+  *n_interior = 0;
+  p2t_cdt_get_map (cdt, &iter);
+  while (p2t_triangle_map_iter_next (&iter, &t))
+    {
+      count++;
+      *n_interior += p2t_triangle_is_interior (t) ? 1 : 0;
+    }
+
+  return count;
+}
+
+/* Several outlines (one with a hole) triangulated at once give the same
+ * indices on every run, and the same triangles and map as triangulating each
+ * outline on its own */
+static void
+test_multi_deterministic (void)
+{
+  GPtrArray *points = g_ptr_array_new ();
+  GPtrArray *polylines = g_ptr_array_new ();
+  GRand *rand = g_rand_new_with_seed (7);
+  GArray *first = g_array_new (FALSE, FALSE, sizeof (guint32));
+  guint n_triangles = 0, n_map = 0, n_interior = 0, i, run, count;
+  gdouble area = 0;
+
+  for (i = 0; i < 8; i++)
+    g_ptr_array_add (polylines, test_ring_new (points, rand, 10 * i, 0, 4, 50 + 10 * i));
+  g_ptr_array_add (polylines, test_ring_new (points, rand, 0, 0, 1.5, 20));
+
+  for (i = 0; i < 8; i++)
+    {
+      P2tPointPtrArray polyline = g_ptr_array_index (polylines, i);
+      P2tCDT *cdt = p2t_cdt_new (polyline);
+      guint interior;
+
+      if (i == 0)
+        p2t_cdt_add_hole (cdt, g_ptr_array_index (polylines, 8));
+      p2t_cdt_triangulate (cdt);
+      n_triangles += p2t_cdt_get_triangles (cdt)->len;
+      area += test_triangles_area (cdt);
+      n_map += test_count_map (cdt, &interior);
+      n_interior += interior;
+      p2t_cdt_free (cdt);
+    }
+
+  for (run = 0; run < 4; run++)
+    {
+      P2tCDT *cdt = p2t_cdt_new_multi (polylines, 0);
+      GArray *indices = g_array_new (FALSE, FALSE, sizeof (guint32));
+      guint interior;
+
+      p2t_cdt_triangulate (cdt);
+      g_assert_cmpuint (p2t_cdt_get_triangles (cdt)->len, ==, n_triangles);
+      g_assert_cmpfloat_with_epsilon (test_triangles_area (cdt), area, 1e-9);
+
+      count = test_count_map (cdt, &interior);
+      g_assert_cmpuint (count, ==, n_map);
+      g_assert_cmpuint (interior, ==, n_interior);
+      g_assert_cmpuint (interior, ==, n_triangles);
+
+      p2t_cdt_get_indices (cdt, indices, NULL);
+      if (run == 0)
+        g_array_append_vals (first, indices->data, indices->len);
+      else
+        {
+          g_assert_cmpuint (indices->len, ==, first->len);
+          g_assert_true (memcmp (indices->data, first->data,
+                                 indices->len * sizeof (guint32)) == 0);
+        }
+
+      g_array_free (indices, TRUE);
+      p2t_cdt_free (cdt);
+    }
+
+  for (i = 0; i < polylines->len; i++)
+    g_ptr_array_free (g_ptr_array_index (polylines, i), TRUE);
+  g_ptr_array_free (polylines, TRUE);
+  g_array_free (first, TRUE);
+  g_rand_free (rand);
+  test_free_points (points);
+}
+
+/* An axis-aligned square, CCW or CW */
+static GPtrArray*
+test_square_new (GPtrArray *points, gdouble x0, gdouble y0, gdouble size,
+                 gboolean ccw)
+{
+  GPtrArray *polyline = g_ptr_array_new ();
+
+  g_ptr_array_add (polyline, test_point_new (points, x0, y0));
+  if (ccw)
+    {
+      g_ptr_array_add (polyline, test_point_new (points, x0 + size, y0));
+      g_ptr_array_add (polyline, test_point_new (points, x0 + size, y0 + size));
+      g_ptr_array_add (polyline, test_point_new (points, x0, y0 + size));
+    }
+  else
+    {
+      g_ptr_array_add (polyline, test_point_new (points, x0, y0 + size));
+      g_ptr_array_add (polyline, test_point_new (points, x0 + size, y0 + size));
+      g_ptr_array_add (polyline, test_point_new (points, x0 + size, y0));
+    }
+
+  return polyline;
+}
+
+/* Whether the indexed output has a triangle with the point of the index */
+static gboolean
+test_indices_have (GArray *indices, guint32 index)
+{
+  guint i;
+
+  for (i = 0; i < indices->len; i++)
+    if (g_array_index (indices, guint32, i) == index)
+      return TRUE;
+  return FALSE;
+}
+
+/* Outlines nested in holes of other outlines, in any order and orientation,
+ * with holes and Steiner points added later going to the innermost outline
+ * around them */
+static void
+test_multi_nesting (void)
+{
+  GPtrArray *points = g_ptr_array_new ();
+  GPtrArray *polylines = g_ptr_array_new ();
+  GArray *indices = g_array_new (FALSE, FALSE, sizeof (guint32));
+  GArray *neighbors = g_array_new (FALSE, FALSE, sizeof (guint32));
+  GPtrArray *hole;
+  P2tCDT *cdt;
+  guint i;
+
+  /* An outline in the hole of another, and a separate outline */
+  g_ptr_array_add (polylines, test_square_new (points, 40, 40, 20, TRUE));    /* hole of 3 */
+  g_ptr_array_add (polylines, test_square_new (points, 0, 0, 100, FALSE));    /* outline */
+  g_ptr_array_add (polylines, test_square_new (points, 200, 0, 60, TRUE));    /* outline */
+  g_ptr_array_add (polylines, test_square_new (points, 20, 20, 60, FALSE));   /* outline */
+  g_ptr_array_add (polylines, test_square_new (points, 220, 20, 20, FALSE));  /* hole of 2 */
+  g_ptr_array_add (polylines, test_square_new (points, 10, 10, 80, TRUE));    /* hole of 1 */
+
+  cdt = p2t_cdt_new_multi (polylines, 0);
+
+  /* Into the outline 3, the outline 1 and the outline 2 */
+  hole = test_square_new (points, 25, 25, 10, TRUE);
+  p2t_cdt_add_hole (cdt, hole);
+  p2t_cdt_add_point (cdt, test_point_new (points, 50, 30));
+  p2t_cdt_add_point (cdt, test_point_new (points, 5, 50));
+  p2t_cdt_add_point (cdt, test_point_new (points, 250, 30));
+
+  p2t_cdt_triangulate (cdt);
+  g_assert_cmpfloat_with_epsilon (test_triangles_area (cdt),
+                                  (100 * 100 - 80 * 80) + (60 * 60 - 20 * 20 - 10 * 10)
+                                  + (60 * 60 - 20 * 20), 1e-9);
+  /* 8 triangles in each ring, 6 more for the hole and 2 for each Steiner
+   * point */
+  g_assert_cmpuint (p2t_cdt_get_triangles (cdt)->len, ==, 3 * 8 + 6 + 3 * 2);
+
+  /* The points of the polylines, then the ones of the hole and the Steiner
+   * points, in the order they were given */
+  p2t_cdt_get_indices (cdt, indices, neighbors);
+  g_assert_cmpuint (indices->len, ==, 3 * p2t_cdt_get_triangles (cdt)->len);
+  for (i = 0; i < indices->len; i++)
+    g_assert_cmpuint (g_array_index (indices, guint32, i), <, points->len);
+  for (i = 0; i < points->len; i++)
+    g_assert_true (test_indices_have (indices, i));
+  g_assert_cmpuint (test_check_neighbors (indices, neighbors), ==, 7 * 4);
+
+  p2t_cdt_free (cdt);
+  for (i = 0; i < polylines->len; i++)
+    g_ptr_array_free (g_ptr_array_index (polylines, i), TRUE);
+  g_ptr_array_free (polylines, TRUE);
+  g_ptr_array_free (hole, TRUE);
+  g_array_free (indices, TRUE);
+  g_array_free (neighbors, TRUE);
+  test_free_points (points);
+}
+
+/* Many outlines spread over the plane, each with a hole and a Steiner point
+ * added after creating the CDT */
+static void
+test_multi_many (void)
+{
+  GPtrArray *points = g_ptr_array_new ();
+  GPtrArray *polylines = g_ptr_array_new ();
+  GArray *indices = g_array_new (FALSE, FALSE, sizeof (guint32));
+  GArray *neighbors = g_array_new (FALSE, FALSE, sizeof (guint32));
+  GPtrArray *holes = g_ptr_array_new ();
+  P2tCDT *cdt;
+  guint i;
+
+  for (i = 0; i < 100; i++)
+    g_ptr_array_add (polylines, test_square_new (points, 20 * (i % 10), 20 * (i / 10), 10, i % 2));
+
+  cdt = p2t_cdt_new_multi (polylines, 0);
+  for (i = 0; i < 100; i++)
+    {
+      gdouble x = 20 * (i % 10), y = 20 * (i / 10);
+
+      g_ptr_array_add (holes, test_square_new (points, x + 4, y + 4, 2, TRUE));
+      p2t_cdt_add_hole (cdt, g_ptr_array_index (holes, i));
+      p2t_cdt_add_point (cdt, test_point_new (points, x + 2, y + 3));
+    }
+
+  p2t_cdt_triangulate (cdt);
+  g_assert_cmpfloat_with_epsilon (test_triangles_area (cdt), 100 * (10 * 10 - 2 * 2), 1e-9);
+  g_assert_cmpuint (p2t_cdt_get_triangles (cdt)->len, ==, 100 * (2 + 6 + 2));
+
+  p2t_cdt_get_indices (cdt, indices, neighbors);
+  for (i = 0; i < points->len; i++)
+    g_assert_true (test_indices_have (indices, i));
+  g_assert_cmpuint (test_check_neighbors (indices, neighbors), ==, 100 * 8);
+
+  p2t_cdt_free (cdt);
+  for (i = 0; i < polylines->len; i++)
+    g_ptr_array_free (g_ptr_array_index (polylines, i), TRUE);
+  for (i = 0; i < holes->len; i++)
+    g_ptr_array_free (g_ptr_array_index (holes, i), TRUE);
+  g_ptr_array_free (polylines, TRUE);
+  g_ptr_array_free (holes, TRUE);
+  g_array_free (indices, TRUE);
+  g_array_free (neighbors, TRUE);
+  test_free_points (points);
+}
+
+int
+main (int argc, char *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/sweep/predicates/orient2d", test_predicates_orient2d);
+  g_test_add_func ("/sweep/predicates/incircle", test_predicates_incircle);
+  g_test_add_func ("/sweep/batch/threads", test_batch_threads);
+  g_test_add_func ("/sweep/reset/reuse", test_reset_reuse);
+  g_test_add_func ("/sweep/indices/neighbors", test_indices_neighbors);
+  g_test_add_func ("/sweep/from-xy/packed", test_from_xy_packed);
+  g_test_add_func ("/sweep/from-xy/strided", test_from_xy_strided);
+  g_test_add_func ("/sweep/from-xy/steiner", test_from_xy_steiner);
+  g_test_add_func ("/sweep/insert-point/inside", test_insert_point_inside);
+  g_test_add_func ("/sweep/insert-point/outside", test_insert_point_outside);
+  g_test_add_func ("/sweep/insert-point/many", test_insert_point_many);
+  g_test_add_func ("/sweep/insert-point/across-dent", test_insert_point_across_dent);
+  g_test_add_func ("/sweep/insert-edge/crossing", test_insert_edge_crossing);
+  g_test_add_func ("/sweep/insert-edge/many", test_insert_edge_many);
+  g_test_add_func ("/sweep/insert-edge/exterior", test_insert_edge_exterior);
+  g_test_add_func ("/sweep/insert-edge/notch", test_insert_edge_notch);
+  g_test_add_func ("/sweep/triangle-func", test_triangle_func);
+  g_test_add_func ("/sweep/multi/deterministic", test_multi_deterministic);
+  g_test_add_func ("/sweep/multi/nesting", test_multi_nesting);
+  g_test_add_func ("/sweep/multi/many", test_multi_many);
+
+  return g_test_run ();
+}